@@ -7,10 +7,27 @@ from aie.iron.placers import SequentialPlacer
 from aie.iron.device import NPU1Col1
 from aie.iron.controlflow import range_
 
-def convolution_module(dev, in_w, in_h, scale_factor):
-    out_w = int(in_w * scale_factor)
-    out_h = int(in_h * scale_factor)
-    c_mtx_cols = int(scale_factor)
+def convolution_module(dev, in_w, in_h, scale_num, scale_den):
+    # scale p/q: p phases per axis, advancing q input pixels every p outputs
+    g = math.gcd(scale_num, scale_den)
+    c_mtx_cols = scale_num // g
+    c_mtx_step = scale_den // g
+    out_w = in_w * c_mtx_cols // c_mtx_step
+    out_h = in_h * c_mtx_cols // c_mtx_step
+
+    # phases of the output rows centered on an input row, by in_y % q:
+    # out_y = (in_y // q) * p + k_y
+    row_phases = [
+        [k for k in range(c_mtx_cols) if k * c_mtx_step // c_mtx_cols == r]
+        for r in range(c_mtx_step)
+    ]
+
+    # the last input rows may center output rows past out_h
+    def last_row_phases(in_y):
+        return [
+            k for k in row_phases[in_y % c_mtx_step]
+            if in_y // c_mtx_step * c_mtx_cols + k < out_h
+        ]
 
     out_t =       np.ndarray[(out_w * out_h,),np.dtype[np.uint8]]
     out_w_t =     np.int32
@@ -33,7 +50,9 @@ def convolution_module(dev, in_w, in_h, scale_factor):
             in_tile_t,      # in_row_3
             c_mtx_row_t,    # c_mtx_row
             np.int32,       # c_mtx_cols
+            np.int32,       # c_mtx_step
             out_tile_t,     # out_row
+            in_w_t,         # in_w
             out_w_t         # out_w
         ],
     )
@@ -63,82 +82,52 @@ def convolution_module(dev, in_w, in_h, scale_factor):
         kernel
     ):
         k_row = c_mtx_fifo.acquire(c_mtx_cols)
-    
-        # First row
-        in_row = in_fifo.acquire(3)
-        
-        for i in range(c_mtx_cols):
-            out_row = out_fifo.acquire(1)
-            kernel(
-                in_row[0],
-                in_row[0],
-                in_row[1],
-                in_row[2],
-                k_row[i],
-                c_mtx_cols,
-                out_row,
-                out_w
-            )
-            out_fifo.release(1)
-        
-        # Middle
-        for _ in range_(in_h - 3):
-            in_row = in_fifo.acquire(4)
-     
-            for i in range(c_mtx_cols):
+
+        def conv_rows(in_row_0, in_row_1, in_row_2, in_row_3, phases):
+            for k in phases:
                 out_row = out_fifo.acquire(1)
                 kernel(
-                    in_row[0],
-                    in_row[1],
-                    in_row[2],
-                    in_row[3],
-                    k_row[i],
+                    in_row_0,
+                    in_row_1,
+                    in_row_2,
+                    in_row_3,
+                    k_row[k],
                     c_mtx_cols,
+                    c_mtx_step,
                     out_row,
+                    in_w,
                     out_w
                 )
                 out_fifo.release(1)
-            
+
+        # First row
+        in_row = in_fifo.acquire(3)
+        conv_rows(in_row[0], in_row[0], in_row[1], in_row[2], row_phases[0])
+
+        # Middle: rows 1 .. in_h - 3, unrolled by q so every row's phases
+        # are known when building the program
+        num_middle = in_h - 3
+        for _ in range_(num_middle // c_mtx_step):
+            for t in range(c_mtx_step):
+                in_row = in_fifo.acquire(4)
+                conv_rows(in_row[0], in_row[1], in_row[2], in_row[3], row_phases[(1 + t) % c_mtx_step])
+                in_fifo.release(1)
+
+        for in_y in range(1 + num_middle - num_middle % c_mtx_step, in_h - 2):
+            in_row = in_fifo.acquire(4)
+            conv_rows(in_row[0], in_row[1], in_row[2], in_row[3], row_phases[in_y % c_mtx_step])
             in_fifo.release(1)
-        
+
         # Second last row
         in_row = in_fifo.acquire(3)
-        
-        for i in range(c_mtx_cols):
-            out_row = out_fifo.acquire(1)
-            kernel(
-                in_row[0],
-                in_row[1],
-                in_row[2],
-                in_row[2],
-                k_row[i],
-                c_mtx_cols,
-                out_row,
-                out_w
-            )
-            out_fifo.release(1)
-        
+        conv_rows(in_row[0], in_row[1], in_row[2], in_row[2], last_row_phases(in_h - 2))
         in_fifo.release(1)
-     
-        # Last row 
+
+        # Last row
         in_row = in_fifo.acquire(2)
-        
-        for i in range(c_mtx_cols):
-            out_row = out_fifo.acquire(1)
-            kernel(
-                in_row[0],
-                in_row[1],
-                in_row[1],
-                in_row[1],
-                k_row[i],
-                c_mtx_cols,
-                out_row,
-                out_w
-            )
-            out_fifo.release(1)
-    
+        conv_rows(in_row[0], in_row[1], in_row[1], in_row[1], last_row_phases(in_h - 1))
         in_fifo.release(2)
-        
+
         c_mtx_fifo.release(c_mtx_cols)
     
     my_worker = Worker(
@@ -172,15 +161,19 @@ def convolution_module(dev, in_w, in_h, scale_factor):
     my_program = Program(dev, rt)
     return my_program.resolve_program(SequentialPlacer())
 
-assert len(sys.argv) == 4, "Expecting 3 arguments: input width, input height, scale factor"
+assert len(sys.argv) == 5, "Expecting 4 arguments: input width, input height, scale numerator, scale denominator"
 
 in_w = int(sys.argv[1])
 in_h = int(sys.argv[2])
-scale_factor = float(sys.argv[3])
+scale_num = int(sys.argv[3])
+scale_den = int(sys.argv[4])
 
 assert in_w % 32 == 0, "Expecting a 32bit aligned input width"
+assert scale_num >= scale_den, "conv2d4k only upscales, the 4x4 window is too narrow for downscaling"
+assert in_w % (scale_den // math.gcd(scale_num, scale_den)) == 0, \
+    "Expecting an input width multiple of the reduced scale denominator"
 
 dev = NPU1Col1()
-module = convolution_module(dev, in_w, in_h, scale_factor)
+module = convolution_module(dev, in_w, in_h, scale_num, scale_den)
 
 print(module)
@@ -0,0 +1,220 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <immintrin.h>
+
+#include "aie_ref.h"
+#include "resize.h"
+#include "thread_pool.h"
+
+int32_t aie_c_mtx_size(int32_t num, int32_t den) {
+    int32_t n_c_mtx = num / gcd(num, den);
+    return C_MTX_PHASE_SIZE * n_c_mtx * n_c_mtx;
+}
+
+void aie_c_mtx_build(int16_t *c_mtx, int32_t num, int32_t den) {
+    int32_t g = gcd(num, den);
+    int32_t n_c_mtx = num / g;
+    int32_t step = den / g;
+    memset(c_mtx, 0, aie_c_mtx_size(num, den) * sizeof(int16_t));
+
+    for (int32_t x = 0; x < n_c_mtx; x++) {
+        for (int32_t y = 0; y < n_c_mtx; y++) {
+            for (int32_t m = -C_MTX_A+1; m <= C_MTX_A; m++) {
+                for (int32_t n = -C_MTX_A+1; n <= C_MTX_A; n++) {
+                    uint32_t in_x = x * step / n_c_mtx;
+                    uint32_t in_y = y * step / n_c_mtx;
+
+                    double i = in_x - (double)x * step / n_c_mtx + m;
+                    double j = in_y - (double)y * step / n_c_mtx + n;
+
+                    double weight = lanczos_kernel(i, C_MTX_A) * lanczos_kernel(j, C_MTX_A);
+                    uint32_t idx = (x + y * n_c_mtx) * C_MTX_PHASE_SIZE \
+                        + (n + C_MTX_A - 1) * C_MTX_TAPS \
+                        + (m + C_MTX_A - 1);
+
+                    c_mtx[idx] = weight * INT_SCALE;
+                }
+            }
+        }
+    }
+}
+
+// one output pixel exactly as the SCALAR build of conv2d4k computes it;
+// CLAMP = false for 1 <= in_x <= in_w - 3, where the window is inside the row
+template <bool CLAMP>
+static inline uint8_t conv2d4k_pixel(uint8_t **in_rows, int32_t in_w, int32_t in_x, int16_t *w) {
+    int32_t pixel = 0;
+    int32_t acc = 0;
+    for (int32_t m = 0; m < C_MTX_TAPS; m++) {
+        int32_t k_in_x = CLAMP ? clamp(in_x + m - 1, 0, in_w - 1) : in_x + m - 1;
+
+        for (int32_t n = 0; n < C_MTX_TAPS; n++) {
+            int32_t idx = C_MTX_TAPS*n + m;
+            acc += w[idx];
+            pixel += (int32_t)(in_rows[n][k_in_x]) * w[idx];
+        }
+    }
+
+    pixel /= acc;
+    return clamp(pixel, 0, 255);
+}
+
+static void conv2d4k_row_scalar(
+    uint8_t **in_rows, int32_t in_w,
+    int16_t *w, uint8_t *out, int32_t x0, int32_t x1
+) {
+    int32_t inside0 = clamp(1, x0, x1);
+    int32_t inside1 = clamp(in_w - 2, inside0, x1);
+
+    int32_t x = x0;
+    for (; x < inside0; x++) out[x] = conv2d4k_pixel<true>(in_rows, in_w, x, w);
+    for (; x < inside1; x++) out[x] = conv2d4k_pixel<false>(in_rows, in_w, x, w);
+    for (; x < x1; x++)      out[x] = conv2d4k_pixel<true>(in_rows, in_w, x, w);
+}
+
+// Same products and sums, 16 input columns at a time. The sums are exact
+// in int32 so the order doesn't matter; the truncating division is done in
+// double, which is exact for |pixel| < 2^31 and |acc| < 2^15
+__attribute__((target("avx2")))
+static inline __m256i div_trunc_avx2(__m256i v, __m256d d) {
+    __m128i lo = _mm256_cvttpd_epi32(_mm256_div_pd(_mm256_cvtepi32_pd(_mm256_castsi256_si128(v)), d));
+    __m128i hi = _mm256_cvttpd_epi32(_mm256_div_pd(_mm256_cvtepi32_pd(_mm256_extracti128_si256(v, 1)), d));
+    return _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+}
+
+__attribute__((target("avx2")))
+static void conv2d4k_row_avx2(
+    uint8_t **in_rows, int32_t in_w,
+    int16_t *w, uint8_t *out
+) {
+    int32_t acc = 0;
+    for (int32_t i = 0; i < C_MTX_PHASE_SIZE; i++) acc += w[i];
+    __m256d d = _mm256_set1_pd(acc);
+
+    // interior only: the loads of x - 1 .. x + 2 + 15 must not need clamping
+    int32_t x;
+    conv2d4k_row_scalar(in_rows, in_w, w, out, 0, 1);
+    for (x = 1; x + 18 <= in_w; x += 16) {
+        __m256i lo = _mm256_setzero_si256();
+        __m256i hi = _mm256_setzero_si256();
+
+        for (int32_t n = 0; n < C_MTX_TAPS; n++) {
+            uint8_t *row = in_rows[n] + x - 1;
+            for (int32_t m = 0; m < C_MTX_TAPS; m += 2) {
+                __m256i v0 = _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i *)(row + m)));
+                __m256i v1 = _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i *)(row + m + 1)));
+                uint16_t w0 = w[C_MTX_TAPS*n + m];
+                uint16_t w1 = w[C_MTX_TAPS*n + m + 1];
+                __m256i wp = _mm256_set1_epi32(w0 | ((uint32_t)w1 << 16));
+
+                lo = _mm256_add_epi32(lo, _mm256_madd_epi16(_mm256_unpacklo_epi16(v0, v1), wp));
+                hi = _mm256_add_epi32(hi, _mm256_madd_epi16(_mm256_unpackhi_epi16(v0, v1), wp));
+            }
+        }
+
+        lo = div_trunc_avx2(lo, d);
+        hi = div_trunc_avx2(hi, d);
+        __m256i px = _mm256_packs_epi32(lo, hi);
+        px = _mm256_permute4x64_epi64(_mm256_packus_epi16(px, px), 0x08);
+        _mm_storeu_si128((__m128i *)(out + x), _mm256_castsi256_si128(px));
+    }
+    conv2d4k_row_scalar(in_rows, in_w, w, out, x, in_w);
+}
+
+struct aie_ref_job {
+    uint8_t *in;
+    int32_t in_w;
+    int32_t in_h;
+    uint8_t *out;
+    int32_t out_w;
+    int32_t out_h;
+    int16_t *c_mtx;
+    int32_t n_c_mtx;        // phases per axis (p)
+    int32_t step;           // input advance per n_c_mtx outputs (q)
+    bool avx2;
+    uint8_t *phase_rows;    // n_c_mtx x in_w per worker
+};
+
+// One input row (the "0" row of conv2d4k) -> the output rows whose phase
+// lands on it: none, one or several depending on in_y % step. The rows
+// above/below are clamped at the borders like aie2.py does
+static void aie_ref_row(int32_t in_y, int32_t worker, void *ctx) {
+    aie_ref_job *job = (aie_ref_job *)ctx;
+    int32_t in_w = job->in_w;
+    int32_t n_c_mtx = job->n_c_mtx;
+    int32_t step = job->step;
+    int32_t out_w = job->out_w;
+    uint8_t *phase_rows = job->phase_rows + (int64_t)worker * n_c_mtx * in_w;
+
+    uint8_t *in_rows[C_MTX_TAPS];
+    for (int32_t n = 0; n < C_MTX_TAPS; n++) {
+        in_rows[n] = job->in + clamp(in_y + n - 1, 0, job->in_h - 1) * in_w;
+    }
+
+    for (int32_t k_y = 0; k_y < n_c_mtx; k_y++) {
+        if (k_y * step / n_c_mtx != in_y % step) continue;
+
+        int32_t out_y = in_y / step * n_c_mtx + k_y;
+        if (out_y >= job->out_h) break;
+
+        // every phase at every input column; for step > 1 only one column in
+        // step is used but the contiguous rows keep the AVX2 path
+        int16_t *c_mtx_row = job->c_mtx + k_y * n_c_mtx * C_MTX_PHASE_SIZE;
+        for (int32_t k_x = 0; k_x < n_c_mtx; k_x++) {
+            int16_t *w = c_mtx_row + k_x * C_MTX_PHASE_SIZE;
+            uint8_t *phase_row = phase_rows + k_x * in_w;
+
+            if (job->avx2) conv2d4k_row_avx2(in_rows, in_w, w, phase_row);
+            else           conv2d4k_row_scalar(in_rows, in_w, w, phase_row, 0, in_w);
+        }
+
+        // interleave the phases: out_x = n_c_mtx * b + k_x reads input column
+        // step * b + k_x * step / n_c_mtx
+        uint8_t *out_row = job->out + (int64_t)out_y * out_w;
+        for (int32_t k_x = 0; k_x < n_c_mtx; k_x++) {
+            uint8_t *phase_row = phase_rows + k_x * in_w + k_x * step / n_c_mtx;
+            for (int32_t b = 0, x = k_x; x < out_w; b++, x += n_c_mtx) {
+                out_row[x] = phase_row[b * step];
+            }
+        }
+    }
+}
+
+uint8_t *lanczos_aie_ref(
+    uint8_t *in,
+    int32_t in_w,
+    int32_t in_h,
+    int32_t num,
+    int32_t den,
+    int32_t threads
+) {
+    if (num <= 0 || den <= 0) {
+        printf("invalid scale factor %i/%i\n", num, den);
+        return NULL;
+    }
+
+    aie_ref_job job;
+    job.in = in;
+    job.in_w = in_w;
+    job.in_h = in_h;
+    job.n_c_mtx = num / gcd(num, den);
+    job.step = den / gcd(num, den);
+    job.avx2 = resize_isa_supported(ISA_AVX2) && resize_get_isa() >= ISA_AVX2;
+
+    job.out_w = (int64_t)in_w * num / den;
+    job.out_h = (int64_t)in_h * num / den;
+    job.out = (uint8_t *)malloc((int64_t)job.out_w * job.out_h * sizeof(uint8_t));
+
+    job.c_mtx = (int16_t *)malloc(aie_c_mtx_size(num, den) * sizeof(int16_t));
+    aie_c_mtx_build(job.c_mtx, num, den);
+
+    int32_t participants = thread_pool_participants(threads);
+    job.phase_rows = (uint8_t *)malloc((int64_t)participants * job.n_c_mtx * in_w);
+
+    thread_pool_run(in_h, threads, aie_ref_row, &job);
+
+    free(job.phase_rows);
+    free(job.c_mtx);
+    return job.out;
+}
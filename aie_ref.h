@@ -0,0 +1,30 @@
+#pragma once
+
+// CPU reference of the conv2d4k AIE kernel (kernel.cpp): same int16
+// coefficient matrix, integer accumulation and truncating division by the
+// coefficient sum, so its output matches the device bit for bit
+
+#include <stdint.h>
+
+// conv2d4k is a 4x4 stencil, i.e. Lanczos with a = 2
+#define C_MTX_A 2
+#define C_MTX_TAPS (2 * C_MTX_A)
+#define C_MTX_PHASE_SIZE (C_MTX_TAPS * C_MTX_TAPS)
+
+// number of int16 entries of the coefficient matrix for the scale num/den
+int32_t aie_c_mtx_size(int32_t num, int32_t den);
+
+// With num/den reduced to p/q: p x p phases of 4x4 weights. Output x uses
+// phase x % p centered on input (x / p) * q + (x % p) * q / p, the same for
+// y. Phase (x, y) is at (x + y * p) * 16, weight (m, n) of a phase at 4 * n + m
+void aie_c_mtx_build(int16_t *c_mtx, int32_t num, int32_t den);
+
+// out = in * num / den, rounded down
+uint8_t *lanczos_aie_ref(
+    uint8_t *in,
+    int32_t in_w,
+    int32_t in_h,
+    int32_t num,
+    int32_t den,
+    int32_t threads = 0
+);
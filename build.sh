@@ -34,6 +34,18 @@ clang++ \
     -I../deps \
     -L$XILINX_XRT/lib \
     -lxrt_coreutil -pthread \
+    -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc \
     `pkg-config --cflags --libs opencv4` \
     -o main \
-    ../main.cpp
+    ../main.cpp \
+    ../aie_ref.cpp \
+    ../decode_resize.cpp \
+    ../image_map.cpp \
+    ../image_write.cpp \
+    ../png_write.cpp \
+    ../resize.cpp \
+    ../resize_simd.cpp \
+    ../resize_stream.cpp \
+    ../resize_tune.cpp \
+    ../yuv.cpp \
+    ../thread_pool.cpp
@@ -0,0 +1,139 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include <stb_image.h>
+
+#include "decode_resize.h"
+#include "resize_stream.h"
+
+// rows the resizer waits for before it wakes up: a few MCU rows, so it
+// isn't woken for every one of them
+#define DECODE_BATCH_ROWS 64
+
+// what the decoder thread has published so far
+struct decode_state {
+    std::mutex lock;
+    std::condition_variable changed;
+    uint8_t *pixels;
+    int32_t w;
+    int32_t h;
+    int32_t rows;       // final rows at the top of pixels
+    bool reading;       // the resizer is pushing rows from pixels
+    bool failed;        // pixels is about to be freed
+    bool done;          // the decoder returned, pixels == NULL if it failed
+};
+
+static void rows_decoded(void *user, stbi_uc *pixels, int x, int y, int, int y1) {
+    decode_state *state = (decode_state *)user;
+
+    std::unique_lock<std::mutex> guard(state->lock);
+    if (!pixels) {
+        // a corrupt scan: stb_image frees the image once this returns
+        state->failed = true;
+        state->changed.notify_all();
+        state->changed.wait(guard, [&]() { return !state->reading; });
+        return;
+    }
+
+    state->pixels = pixels;
+    state->w = x;
+    state->h = y;
+    state->rows = y1;
+    state->changed.notify_all();
+}
+
+uint8_t *lanczos_decode(
+    const char *path,
+    int32_t channels,
+    int32_t num,
+    int32_t den,
+    int32_t a,
+    int32_t *out_w,
+    int32_t *out_h
+) {
+    if (channels < 1 || channels > 4) {
+        printf("can't decode %s to %i channels\n", path, channels);
+        return NULL;
+    }
+
+    decode_state state;
+    state.pixels = NULL;
+    state.w = 0;
+    state.h = 0;
+    state.rows = 0;
+    state.reading = false;
+    state.failed = false;
+    state.done = false;
+
+    std::thread decoder([&state, path, channels]() {
+        int32_t w, h, c;
+        uint8_t *pixels = stbi_load_rows(path, &w, &h, &c, channels, rows_decoded, &state);
+        if (!pixels) printf("can't decode %s: %s\n", path, stbi_failure_reason());
+
+        std::lock_guard<std::mutex> guard(state.lock);
+        state.pixels = pixels;
+        state.done = true;
+        state.changed.notify_all();
+    });
+
+    lanczos_stream *stream = NULL;
+    uint8_t *out = NULL;
+    int32_t pushed = 0;
+    int32_t pulled = 0;
+    for (bool done = false; !done; ) {
+        uint8_t *pixels;
+        int32_t w, h, rows;
+        {
+            std::unique_lock<std::mutex> guard(state.lock);
+            state.changed.wait(guard, [&]() {
+                return state.rows >= pushed + DECODE_BATCH_ROWS || state.failed || state.done;
+            });
+            if (state.failed || !state.pixels) break;
+
+            pixels = state.pixels;
+            w = state.w;
+            h = state.h;
+            rows = state.rows;
+            done = state.done;
+            state.reading = true;
+        }
+
+        if (!stream) stream = lanczos_stream_create(w, h, channels, num, den, a);
+        if (stream && !out) out = (uint8_t *)malloc((int64_t)stream->out_w * stream->out_h * channels);
+
+        // the published rows are final, the decoder only writes below them
+        int64_t in_row = (int64_t)w * channels;
+        int64_t out_row = stream ? (int64_t)stream->out_w * channels : 0;
+        while (stream && pushed < rows) {
+            if (lanczos_stream_push(stream, pixels + pushed * in_row)) {
+                pushed++;
+            } else {
+                lanczos_stream_pull(stream, out + pulled * out_row);
+                pulled++;
+            }
+        }
+        while (stream && done && lanczos_stream_pull(stream, out + pulled * out_row)) pulled++;
+
+        std::lock_guard<std::mutex> guard(state.lock);
+        state.reading = false;
+        state.changed.notify_all();
+        if (!stream) break;
+    }
+    decoder.join();
+
+    if (!stream || pulled < stream->out_h) {
+        free(out);
+        out = NULL;
+    } else {
+        *out_w = stream->out_w;
+        *out_h = stream->out_h;
+    }
+
+    if (stream) lanczos_stream_free(stream);
+    stbi_image_free(state.pixels);
+    return out;
+}
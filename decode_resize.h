@@ -0,0 +1,22 @@
+#pragma once
+
+// JPEG decode and resize overlapped: stb_image decodes on a thread of its
+// own and hands over rows as each MCU row of the scan is finished, while the
+// caller's thread streams them through lanczos_stream. Wall time tends to
+// the slower of the two instead of their sum. Images stb_image can't decode
+// row by row (progressive JPEGs, other formats) are resized after decoding
+
+#include <stdint.h>
+
+// Decodes path with channels (1 to 4) per pixel and resizes it by num/den
+// with Lanczos a, clamped borders. Returns the malloc'ed *out_w x *out_h
+// image, NULL if it can't be decoded or the parameters are invalid
+uint8_t *lanczos_decode(
+    const char *path,
+    int32_t channels,
+    int32_t num,
+    int32_t den,
+    int32_t a,
+    int32_t *out_w,
+    int32_t *out_h
+);
@@ -0,0 +1,228 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "image_map.h"
+
+// rows swapped per chunk when finishing a 16-bit PGM / PPM sink, released
+// behind so the swap doesn't pull the whole file in
+#define SWAP_CHUNK_ROWS 64
+
+// header alignment of the sinks, so 16-bit rows start on a 16 byte boundary
+#define HEADER_ALIGN 16
+
+static bool map_file(const char *path, bool writable, int64_t size, mapped_image *image) {
+    int32_t fd = writable ? open(path, O_RDWR | O_CREAT | O_TRUNC, 0644) : open(path, O_RDONLY);
+    if (fd < 0) {
+        printf("can't open %s\n", path);
+        return false;
+    }
+
+    if (writable && ftruncate(fd, size) != 0) {
+        printf("can't size %s to %lld bytes\n", path, (long long)size);
+        close(fd);
+        return false;
+    }
+    if (!writable) {
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0) {
+            printf("can't map empty %s\n", path);
+            close(fd);
+            return false;
+        }
+        size = st.st_size;
+    }
+
+    void *map = mmap(NULL, size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        printf("can't map %s\n", path);
+        close(fd);
+        return false;
+    }
+
+    // the engine goes down the rows: read ahead, and drop pages behind
+    madvise(map, size, MADV_SEQUENTIAL);
+
+    image->fd = fd;
+    image->map = (uint8_t *)map;
+    image->map_size = size;
+    image->writable = writable;
+    return true;
+}
+
+static void unmap_file(mapped_image *image) {
+    munmap(image->map, image->map_size);
+    close(image->fd);
+    image->map = NULL;
+    image->pixels = NULL;
+}
+
+// next whitespace separated number of a PNM header, skipping # comments
+static bool pnm_number(const uint8_t *map, int64_t size, int64_t *pos, int32_t *value) {
+    while (*pos < size) {
+        if (map[*pos] == '#') {
+            while (*pos < size && map[*pos] != '\n') (*pos)++;
+        } else if (isspace(map[*pos])) {
+            (*pos)++;
+        } else {
+            break;
+        }
+    }
+
+    int64_t n = 0;
+    int64_t start = *pos;
+    while (*pos < size && isdigit(map[*pos]) && *pos - start < 10) {
+        n = n * 10 + map[*pos] - '0';
+        (*pos)++;
+    }
+    if (*pos == start || n > INT32_MAX) return false;
+    *value = n;
+    return true;
+}
+
+static bool check_layout(const char *path, mapped_image *image, int64_t offset) {
+    if (image->w <= 0 || image->h <= 0 || image->channels < 1 || (image->depth != 1 && image->depth != 2)) {
+        printf("invalid image %s: %ix%ix%i, %i bytes per sample\n", path, image->w, image->h, image->channels, image->depth);
+        return false;
+    }
+
+    image->stride = image->w * image->channels * image->depth;
+    if (offset + (int64_t)image->stride * image->h > image->map_size) {
+        printf("%s is shorter than a %ix%ix%i image\n", path, image->w, image->h, image->channels);
+        return false;
+    }
+    image->pixels = image->map + offset;
+    return true;
+}
+
+bool image_map_read(const char *path, mapped_image *image) {
+    if (!map_file(path, false, 0, image)) return false;
+
+    uint8_t *map = image->map;
+    int64_t pos = 2;
+    int32_t max_value;
+    if (image->map_size < 2 || map[0] != 'P' || (map[1] != '5' && map[1] != '6') ||
+        !pnm_number(map, image->map_size, &pos, &image->w) ||
+        !pnm_number(map, image->map_size, &pos, &image->h) ||
+        !pnm_number(map, image->map_size, &pos, &max_value) ||
+        max_value < 1 || max_value > UINT16_MAX) {
+        printf("%s isn't a binary PGM / PPM\n", path);
+        unmap_file(image);
+        return false;
+    }
+
+    image->format = IMAGE_PNM;
+    image->channels = map[1] == '5' ? 1 : 3;
+    image->depth = max_value > UINT8_MAX ? 2 : 1;
+    if (image->depth == 2) {
+        printf("%s: 16-bit PGM / PPM samples are big-endian, map it as raw host order samples\n", path);
+        unmap_file(image);
+        return false;
+    }
+
+    // a single whitespace character ends the header
+    if (!check_layout(path, image, pos + 1)) {
+        unmap_file(image);
+        return false;
+    }
+    return true;
+}
+
+bool image_map_read_raw(const char *path, int32_t w, int32_t h, int32_t channels, int32_t depth, mapped_image *image) {
+    if (!map_file(path, false, 0, image)) return false;
+
+    image->format = IMAGE_RAW;
+    image->w = w;
+    image->h = h;
+    image->channels = channels;
+    image->depth = depth;
+    if (!check_layout(path, image, 0)) {
+        unmap_file(image);
+        return false;
+    }
+    return true;
+}
+
+bool image_map_create(
+    const char *path, image_format format,
+    int32_t w, int32_t h, int32_t channels, int32_t depth,
+    mapped_image *image
+) {
+    if (format == IMAGE_BMP) {
+        // BGR order and padded rows: not what the resizer writes
+        printf("can't map a BMP sink, write it with image_write()\n");
+        return false;
+    }
+    if (format == IMAGE_PNM && channels != 1 && channels != 3) {
+        printf("PGM / PPM have 1 or 3 channels, not %i\n", channels);
+        return false;
+    }
+
+    // "P5\n", a comment padding it to HEADER_ALIGN, then the size
+    char size_line[64];
+    char header[64 + HEADER_ALIGN] = "";
+    if (format == IMAGE_PNM) {
+        snprintf(size_line, sizeof(size_line), "%i %i\n%i\n", w, h, depth == 2 ? UINT16_MAX : UINT8_MAX);
+        int32_t len = 3 + strlen(size_line);
+        int32_t pad = (HEADER_ALIGN - len % HEADER_ALIGN) % HEADER_ALIGN;
+        if (pad == 1) pad += HEADER_ALIGN;
+
+        strcpy(header, channels == 1 ? "P5\n" : "P6\n");
+        if (pad) {
+            strcat(header, "#");
+            memset(header + 4, ' ', pad - 2);
+            strcpy(header + 4 + pad - 2, "\n");
+        }
+        strcat(header, size_line);
+    }
+
+    int64_t offset = strlen(header);
+    int64_t size = offset + (int64_t)w * h * channels * depth;
+    if (w <= 0 || h <= 0 || !map_file(path, true, size, image)) return false;
+
+    image->format = format;
+    image->w = w;
+    image->h = h;
+    image->channels = channels;
+    image->depth = depth;
+    if (!check_layout(path, image, offset)) {
+        unmap_file(image);
+        return false;
+    }
+    memcpy(image->map, header, offset);
+    return true;
+}
+
+void image_release_rows(mapped_image *image, int32_t y0, int32_t y1) {
+    // only the pages entirely within the rows
+    int64_t page = sysconf(_SC_PAGESIZE);
+    uintptr_t start = (uintptr_t)(image->pixels + (int64_t)y0 * image->stride);
+    uintptr_t end = (uintptr_t)(image->pixels + (int64_t)y1 * image->stride);
+    start = (start + page - 1) / page * page;
+    end = end / page * page;
+    if (start < end) madvise((void *)start, end - start, MADV_DONTNEED);
+}
+
+void image_unmap(mapped_image *image) {
+    if (!image->map) return;
+
+    if (image->writable && image->format == IMAGE_PNM && image->depth == 2) {
+        for (int32_t y0 = 0; y0 < image->h; y0 += SWAP_CHUNK_ROWS) {
+            int32_t y1 = y0 + SWAP_CHUNK_ROWS < image->h ? y0 + SWAP_CHUNK_ROWS : image->h;
+            uint16_t *samples = (uint16_t *)(image->pixels + (int64_t)y0 * image->stride);
+            int64_t count = (int64_t)(y1 - y0) * image->stride / 2;
+            for (int64_t i = 0; i < count; i++) {
+                samples[i] = __builtin_bswap16(samples[i]);
+            }
+            image_release_rows(image, y0, y1);
+        }
+    }
+
+    unmap_file(image);
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+// Images backed by a memory mapped file: raw samples, or binary PGM / PPM
+// (P5 / P6). pixels points into the mapping, so lanczos_into() and the
+// stream read a source and write a sink in place, and the page cache is
+// the only buffer: peak RSS follows the rows being worked on, not the file.
+// Raw 16-bit samples are in host order; PGM / PPM ones are big-endian
+
+#include <stdint.h>
+
+enum image_format {
+    IMAGE_RAW,
+    IMAGE_PNM,      // PGM for 1 channel, PPM for 3
+    IMAGE_BMP       // top-down BGR(A) or paletted gray, image_write.h only
+};
+
+struct mapped_image {
+    image_format format;
+    int32_t w;
+    int32_t h;
+    int32_t channels;
+    int32_t depth;      // bytes per sample, 1 or 2 (uint16)
+    int32_t stride;     // bytes between rows
+    uint8_t *pixels;    // first row, inside the mapping
+    bool writable;      // a sink, see image_map_create()
+    int32_t fd;
+    uint8_t *map;
+    int64_t map_size;
+};
+
+// Maps a PGM / PPM source read-only, with a sequential access hint. False
+// if the file can't be mapped or isn't a P5 / P6 image. 16-bit PGM / PPM
+// sources aren't taken: swapping their samples would copy the whole file,
+// convert them to raw instead
+bool image_map_read(const char *path, mapped_image *image);
+
+// Maps a headerless source of h rows of w * channels samples of depth bytes
+bool image_map_read_raw(const char *path, int32_t w, int32_t h, int32_t channels, int32_t depth, mapped_image *image);
+
+// Creates (or truncates) path at the size of the image and maps it for
+// writing, the PGM / PPM header already in place. The samples are whatever
+// the caller writes to pixels before image_unmap()
+bool image_map_create(
+    const char *path, image_format format,
+    int32_t w, int32_t h, int32_t channels, int32_t depth,
+    mapped_image *image
+);
+
+// Rows [y0, y1) won't be touched again: drops their pages from the process
+// (written ones stay in the page cache until written back). Lets a job
+// going down the image, e.g. with lanczos_stream, keep its RSS bounded
+// even where the kernel keeps the pages around
+void image_release_rows(mapped_image *image, int32_t y0, int32_t y1);
+
+// Unmaps, first swapping a 16-bit PGM / PPM sink to big-endian in place
+void image_unmap(mapped_image *image);
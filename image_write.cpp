@@ -0,0 +1,250 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "image_write.h"
+
+#define BMP_HEADER_BYTES (14 + 40)
+#define BMP_PALETTE_BYTES (256 * 4)
+#define BMP_PPM 2835    // 72 dpi
+
+static const uint8_t zeros[4] = { 0, 0, 0, 0 };
+
+// bytes of a row in the file: BMP rows are padded to 4 bytes
+static int32_t file_row_bytes(image_format format, int32_t w, int32_t channels) {
+    int32_t bytes = w * channels;
+    return format == IMAGE_BMP ? (bytes + 3) & ~3 : bytes;
+}
+
+// BMP stores color as BGR(A)
+static bool needs_swizzle(image_format format, int32_t channels) {
+    return format == IMAGE_BMP && channels >= 3;
+}
+
+static bool check_format(const char *path, image_format format, int32_t w, int32_t h, int32_t channels) {
+    if (w <= 0 || h <= 0 || channels < 1 || channels > 4) {
+        printf("invalid image %s: %ix%ix%i\n", path, w, h, channels);
+        return false;
+    }
+    if (format == IMAGE_PNM && channels != 1 && channels != 3) {
+        printf("PGM / PPM have 1 or 3 channels, not %i\n", channels);
+        return false;
+    }
+    if (format == IMAGE_BMP && channels == 2) {
+        printf("BMP has 1, 3 or 4 channels, not %i\n", channels);
+        return false;
+    }
+    if (format == IMAGE_BMP && BMP_HEADER_BYTES + BMP_PALETTE_BYTES + (int64_t)file_row_bytes(format, w, channels) * h > UINT32_MAX) {
+        printf("%s: %ix%i is too large for a BMP\n", path, w, h);
+        return false;
+    }
+    return true;
+}
+
+static uint8_t *put16(uint8_t *p, uint32_t value) {
+    p[0] = value;
+    p[1] = value >> 8;
+    return p + 2;
+}
+
+static uint8_t *put32(uint8_t *p, uint32_t value) {
+    p = put16(p, value);
+    return put16(p, value >> 16);
+}
+
+// writes the header of the format to header, at most
+// BMP_HEADER_BYTES + BMP_PALETTE_BYTES, and returns its length
+static int32_t file_header(image_format format, int32_t w, int32_t h, int32_t channels, uint8_t *header) {
+    if (format == IMAGE_PNM) {
+        return sprintf((char *)header, "P%c\n%i %i\n255\n", channels == 1 ? '5' : '6', w, h);
+    }
+    if (format != IMAGE_BMP) return 0;
+
+    uint32_t palette = channels == 1 ? BMP_PALETTE_BYTES : 0;
+    uint32_t offset = BMP_HEADER_BYTES + palette;
+    uint32_t image_size = file_row_bytes(format, w, channels) * h;
+
+    uint8_t *p = header;
+    *p++ = 'B';
+    *p++ = 'M';
+    p = put32(p, offset + image_size);
+    p = put32(p, 0);
+    p = put32(p, offset);
+
+    p = put32(p, 40);
+    p = put32(p, w);
+    p = put32(p, -h);       // top-down
+    p = put16(p, 1);
+    p = put16(p, channels * 8);
+    p = put32(p, 0);        // BI_RGB
+    p = put32(p, image_size);
+    p = put32(p, BMP_PPM);
+    p = put32(p, BMP_PPM);
+    p = put32(p, palette ? 256 : 0);
+    p = put32(p, 0);
+
+    for (uint32_t i = 0; i < palette / 4; i++) {
+        *p++ = i;
+        *p++ = i;
+        *p++ = i;
+        *p++ = 0;
+    }
+    return p - header;
+}
+
+// writev() of all of iov, IOV_MAX at a time and resuming partial writes.
+// Consumes iov
+static bool write_all(int32_t fd, struct iovec *iov, int64_t count) {
+    while (count > 0) {
+        ssize_t n = writev(fd, iov, count < IOV_MAX ? count : IOV_MAX);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+
+        for (; count > 0 && (size_t)n >= iov->iov_len; iov++, count--) {
+            n -= iov->iov_len;
+        }
+        if (count > 0) {
+            iov->iov_base = (uint8_t *)iov->iov_base + n;
+            iov->iov_len -= n;
+        }
+    }
+    return true;
+}
+
+// a row as the file stores it, padding included
+static void file_row(image_writer *writer, const uint8_t *row, uint8_t *out) {
+    int32_t bytes = writer->w * writer->channels;
+    if (needs_swizzle(writer->format, writer->channels)) {
+        int32_t c = writer->channels;
+        for (int32_t x = 0; x < bytes; x += c) {
+            out[x] = row[x + 2];
+            out[x + 1] = row[x + 1];
+            out[x + 2] = row[x];
+            if (c == 4) out[x + 3] = row[x + 3];
+        }
+    } else {
+        memcpy(out, row, bytes);
+    }
+    memset(out + bytes, 0, writer->row_bytes - bytes);
+}
+
+static bool flush_chunk(image_writer *writer) {
+    struct iovec iov = { writer->chunk, (size_t)writer->chunk_used };
+    if (writer->chunk_used && !write_all(writer->fd, &iov, 1)) {
+        printf("image write failed at row %i: %s\n", writer->rows, strerror(errno));
+        writer->failed = true;
+    }
+    writer->chunk_used = 0;
+    return !writer->failed;
+}
+
+image_writer *image_writer_open(const char *path, image_format format, int32_t w, int32_t h, int32_t channels) {
+    if (!check_format(path, format, w, h, channels)) return NULL;
+
+    int32_t fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        printf("can't open %s\n", path);
+        return NULL;
+    }
+
+    image_writer *writer = (image_writer *)malloc(sizeof(image_writer));
+    writer->format = format;
+    writer->w = w;
+    writer->h = h;
+    writer->channels = channels;
+    writer->row_bytes = file_row_bytes(format, w, channels);
+    writer->rows = 0;
+    writer->fd = fd;
+    writer->chunk_size = writer->row_bytes > WRITER_CHUNK_BYTES ? writer->row_bytes : WRITER_CHUNK_BYTES;
+    writer->chunk = (uint8_t *)malloc(writer->chunk_size);
+    writer->chunk_used = file_header(format, w, h, channels, writer->chunk);
+    writer->failed = false;
+    return writer;
+}
+
+bool image_writer_row(image_writer *writer, const uint8_t *row) {
+    if (writer->failed || writer->rows >= writer->h) return false;
+    if (writer->chunk_used + writer->row_bytes > writer->chunk_size && !flush_chunk(writer)) return false;
+
+    file_row(writer, row, writer->chunk + writer->chunk_used);
+    writer->chunk_used += writer->row_bytes;
+    writer->rows++;
+    return true;
+}
+
+bool image_writer_close(image_writer *writer) {
+    bool ok = flush_chunk(writer);
+    if (ok && writer->rows < writer->h) {
+        printf("image closed after %i of %i rows\n", writer->rows, writer->h);
+        ok = false;
+    }
+
+    close(writer->fd);
+    free(writer->chunk);
+    free(writer);
+    return ok;
+}
+
+bool image_write(
+    const char *path, image_format format,
+    const uint8_t *pixels, int32_t w, int32_t h, int32_t channels, int32_t stride
+) {
+    if (!check_format(path, format, w, h, channels)) return false;
+
+    // swizzled rows go through the chunk of a writer
+    if (needs_swizzle(format, channels)) {
+        image_writer *writer = image_writer_open(path, format, w, h, channels);
+        if (!writer) return false;
+        for (int32_t y = 0; y < h; y++) {
+            image_writer_row(writer, pixels + (int64_t)y * stride);
+        }
+        return image_writer_close(writer);
+    }
+
+    int32_t fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        printf("can't open %s\n", path);
+        return false;
+    }
+
+    // the header, then every row from the image itself and its padding.
+    // Rows that follow each other in memory go in one iovec, so a packed
+    // image is a single writev() of two
+    uint8_t header[BMP_HEADER_BYTES + BMP_PALETTE_BYTES];
+    int32_t bytes = w * channels;
+    int32_t pad = file_row_bytes(format, w, channels) - bytes;
+    struct iovec *iov = (struct iovec *)malloc((1 + (int64_t)h * (pad ? 2 : 1)) * sizeof(struct iovec));
+
+    int64_t count = 0;
+    iov[count].iov_base = header;
+    iov[count++].iov_len = file_header(format, w, h, channels, header);
+    for (int32_t y = 0; y < h; y++) {
+        const uint8_t *row = pixels + (int64_t)y * stride;
+        struct iovec *last = &iov[count - 1];
+        if (y > 0 && !pad && (uint8_t *)last->iov_base + last->iov_len == row) {
+            last->iov_len += bytes;
+        } else {
+            iov[count].iov_base = (void *)row;
+            iov[count++].iov_len = bytes;
+        }
+        if (pad) {
+            iov[count].iov_base = (void *)zeros;
+            iov[count++].iov_len = pad;
+        }
+    }
+
+    bool ok = write_all(fd, iov, count);
+    if (!ok) printf("can't write %s: %s\n", path, strerror(errno));
+
+    free(iov);
+    close(fd);
+    return ok;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+// Image files written in bulk: the header and the rows go out in a few
+// large writes instead of stb_image_write's per pixel callbacks. Rows that
+// are stored as they are (raw, PGM / PPM, gray BMP) are written straight
+// from the caller's buffer with writev(); BMP color rows are swizzled to
+// BGR(A) through a chunk buffer first. BMPs are written top-down
+
+#include <stdint.h>
+
+#include "image_map.h"
+
+// size of the buffer rows are gathered in before a write
+#define WRITER_CHUNK_BYTES (1 << 20)
+
+// A file being written row by row, e.g. from lanczos_stream_pull(), so an
+// image never has to be complete in memory
+struct image_writer {
+    image_format format;
+    int32_t w;
+    int32_t h;
+    int32_t channels;
+    int32_t row_bytes;  // in the file, padding included
+    int32_t rows;       // written so far
+    int32_t fd;
+    uint8_t *chunk;     // WRITER_CHUNK_BYTES, or one row if that's larger
+    int64_t chunk_size;
+    int64_t chunk_used;
+    bool failed;
+};
+
+// Writes the w x h image of channels interleaved samples per pixel, rows
+// stride bytes apart, to path. Raw takes any channel count, PGM / PPM 1 or
+// 3, BMP 1 (with a gray palette), 3 or 4. False if the format can't hold
+// the image or the file can't be written
+bool image_write(
+    const char *path, image_format format,
+    const uint8_t *pixels, int32_t w, int32_t h, int32_t channels, int32_t stride
+);
+
+// Creates path and writes the header. NULL if the format can't hold the
+// image or the file can't be created
+image_writer *image_writer_open(const char *path, image_format format, int32_t w, int32_t h, int32_t channels);
+
+// Appends the next row, w * channels samples. False once a write failed or
+// all h rows were given
+bool image_writer_row(image_writer *writer, const uint8_t *row);
+
+// Flushes, closes and frees the writer. False if a write failed or fewer
+// than h rows were given
+bool image_writer_close(image_writer *writer);
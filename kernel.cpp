@@ -83,53 +83,149 @@ void conv2d3k2x(
 
 
 
+// Input column of the window center of output out_x: phase out_x % p of the
+// block of p outputs that starts at input column (out_x / p) * q
+static inline int32_t conv2d4k_in_x(int32_t out_x, int32_t num_c_mtx_row, int32_t c_mtx_step) {
+    int32_t k_x = out_x % num_c_mtx_row;
+    return out_x / num_c_mtx_row * c_mtx_step + k_x * c_mtx_step / num_c_mtx_row;
+}
+
+// The 4x4 window of a center column in_x reads columns in_x - 1 .. in_x + 2,
+// all inside the row for 1 <= in_x <= in_w - 3. Only a few windows at each
+// end need clamping, so they get their own CLAMP = true instantiation and
+// the interior runs without any bounds checks
+
+#ifdef SCALAR
+template <bool CLAMP>
+static inline uint8_t conv2d4k_pixel(
+    uint8_t **in_rows, int16_t *w, int32_t in_x, int32_t in_w
+) {
+    int32_t pixel = 0;
+    int32_t acc = 0;
+    for (int32_t m = 0; m < 4; m++) {
+        int32_t k_in_x = in_x + m - 1;
+        if (CLAMP) {
+            if (k_in_x < 0) k_in_x = 0;
+            if (k_in_x > in_w - 1) k_in_x = in_w - 1;
+        }
+
+        for (int32_t n = 0; n < 4; n++) {
+            int16_t c = w[4*n + m];
+            acc += c;
+            pixel += (int32_t)(in_rows[n][k_in_x]) * c;
+        }
+    }
+
+    pixel /= acc;
+
+    // clamp
+    if (pixel < 0) pixel = 0;
+    if (pixel > 255) pixel = 255;
+    return pixel;
+}
+#else
+// half h of in_vec <- the window centered on input column in_x0
+template <bool CLAMP>
+static inline void conv2d4k_fill(
+    aie::vector<int16_t, 32> &in_vec, int32_t h,
+    uint8_t **in_rows, int32_t in_x0, int32_t in_w
+) {
+    for (int32_t k_x = 0; k_x < 4; k_x++) {
+        int32_t in_x = in_x0 + k_x - 1;
+        if (CLAMP) {
+            if (in_x < 0) in_x = 0;
+            if (in_x > in_w - 1) in_x = in_w - 1;
+        }
+
+        in_vec[16*h + k_x]      = in_rows[0][in_x];
+        in_vec[16*h + 4 + k_x]  = in_rows[1][in_x];
+        in_vec[16*h + 8 + k_x]  = in_rows[2][in_x];
+        in_vec[16*h + 12 + k_x] = in_rows[3][in_x];
+    }
+}
+
+// the first num_out <= num_c_mtx_row outputs of block i, two phases per
+// multiplication. Only the last block of a row can be short
+template <bool CLAMP>
+static inline void conv2d4k_block(
+    uint8_t **in_rows, int32_t i,
+    int16_t *c_mtx_row, int32_t num_c_mtx_row, int32_t c_mtx_step,
+    uint8_t *out_row, int32_t in_w, int32_t num_out
+) {
+    int32_t num_mul = num_out / 2 + num_out % 2;
+
+    aie::vector<int16_t, 32> in_vec = aie::zeros<int16_t, 32>();
+    int32_t vec_x[2] = {-1, -1};    // input column each half was filled for
+
+    for (int32_t mul_i = 0; mul_i < num_mul; mul_i++) {
+        bool odd_mul = mul_i == num_mul - 1 && num_out % 2;
+        int32_t num_p = odd_mul ? 1 : 2;
+
+        // fill input vector: half p holds the window of phase 2*mul_i + p,
+        // refilled only when the phase moves to another input column
+        for (int32_t p = 0; p < num_p; p++) {
+            int32_t k_x0 = (2*mul_i + p) * c_mtx_step / num_c_mtx_row;
+            int32_t in_x0 = i * c_mtx_step + k_x0;
+            if (in_x0 == vec_x[p]) continue;
+            vec_x[p] = in_x0;
+
+            conv2d4k_fill<CLAMP>(in_vec, p, in_rows, in_x0, in_w);
+        }
+
+        // fill c_mtx_row vector
+        aie::vector<int16_t, 32> c_mtx_vec = aie::load_v<32>(c_mtx_row + 32*mul_i);
+        
+        // run the two convolutions
+        aie::accum<acc32, 32> s = aie::mul(in_vec, c_mtx_vec);
+        aie::vector<int32_t, 32> s_vec = aie::to_vector<int32_t>(s);
+       
+        for (int32_t p = 0; p < num_p; p++) {
+            int32_t pixel = aie::reduce_add(s_vec.extract<16>(p));
+            int32_t sum = aie::reduce_add(c_mtx_vec.extract<16>(p));
+            
+            pixel /= sum;
+            if (pixel < 0)   pixel = 0;
+            if (pixel > 255) pixel = 255;
+            
+            out_row[num_c_mtx_row*i + 2*mul_i + p] = pixel;
+        }
+    } 
+}
+#endif
+
 extern "C" {
+// Scale p/q: output x uses phase x % p of c_mtx_row, centered on input column
+// (x / p) * q + (x % p) * q / p. The caller passes the input rows of the same
+// mapping for y, and the c_mtx row of phase y % p
 #ifdef SCALAR
 void conv2d4k(
     uint8_t *in_row_0,  // -1
     uint8_t *in_row_1,  //  0 
     uint8_t *in_row_2,  //  1
     uint8_t *in_row_3,  //  2
-    int16_t *c_mtx_row, int32_t num_c_mtx_row,
-    uint8_t *out_row, int32_t out_w
+    int16_t *c_mtx_row, int32_t num_c_mtx_row, int32_t c_mtx_step,
+    uint8_t *out_row, int32_t in_w, int32_t out_w
 ) {
-    int32_t scale_factor = num_c_mtx_row;
-
-    for (int32_t out_x = 0; out_x < out_w; out_x++) {
-        int32_t in_x = out_x / scale_factor;
-        int32_t k_x = out_x % scale_factor;
-        
-        int32_t pixel = 0;
-        int32_t acc = 0;
-        for (int32_t m = 0; m < 4; m++) {
-            for (int32_t n = 0; n < 4; n++) {
-                int32_t idx = 16*k_x + 4*n + m;
-                int16_t w = c_mtx_row[idx];
-                acc += w;
-
-                // select row
-                uint8_t *in_row = 0;
-                if (n == 0)      in_row = in_row_0;
-                else if (n == 1) in_row = in_row_1;
-                else if (n == 2) in_row = in_row_2;
-                else if (n == 3) in_row = in_row_3;
+    uint8_t *in_rows[4] = {in_row_0, in_row_1, in_row_2, in_row_3};
 
-                // clamp 
-                int32_t k_in_x = in_x + m - 1;
-                if (k_in_x < 0) k_in_x = 0;
-                if (k_in_x > out_w / 2 - 1) k_in_x = out_w / scale_factor - 1;
-              
-                pixel += (int32_t)(in_row[k_in_x]) * w;
-            }
-        }
-        
-        pixel /= acc;
-        
-        // clamp
-        if (pixel < 0) pixel = 0;
-        if (pixel > 255) pixel = 255;
+    // interior [x0, x1): the centers only grow with out_x
+    int32_t x0 = 0;
+    while (x0 < out_w && conv2d4k_in_x(x0, num_c_mtx_row, c_mtx_step) < 1) x0++;
+    int32_t x1 = out_w;
+    while (x1 > x0 && conv2d4k_in_x(x1 - 1, num_c_mtx_row, c_mtx_step) > in_w - 3) x1--;
 
-        out_row[out_x] = pixel;
+    int32_t out_x = 0;
+    for (; out_x < x0; out_x++) {
+        int16_t *w = c_mtx_row + 16 * (out_x % num_c_mtx_row);
+        out_row[out_x] = conv2d4k_pixel<true>(in_rows, w, conv2d4k_in_x(out_x, num_c_mtx_row, c_mtx_step), in_w);
+    }
+    for (; out_x < x1; out_x++) {
+        int16_t *w = c_mtx_row + 16 * (out_x % num_c_mtx_row);
+        out_row[out_x] = conv2d4k_pixel<false>(in_rows, w, conv2d4k_in_x(out_x, num_c_mtx_row, c_mtx_step), in_w);
+    }
+    for (; out_x < out_w; out_x++) {
+        int16_t *w = c_mtx_row + 16 * (out_x % num_c_mtx_row);
+        out_row[out_x] = conv2d4k_pixel<true>(in_rows, w, conv2d4k_in_x(out_x, num_c_mtx_row, c_mtx_step), in_w);
     }
 }
 #else
@@ -138,51 +234,32 @@ void conv2d4k(
     uint8_t *in_row_1,  //  0 
     uint8_t *in_row_2,  //  1
     uint8_t *in_row_3,  //  2
-    int16_t *c_mtx_row, int32_t num_c_mtx_row,
-    uint8_t *out_row, int32_t out_w
+    int16_t *c_mtx_row, int32_t num_c_mtx_row, int32_t c_mtx_step,
+    uint8_t *out_row, int32_t in_w, int32_t out_w
 ) {
-    int32_t num_mul = num_c_mtx_row / 2 + num_c_mtx_row % 2;
-    int32_t scale_factor = num_c_mtx_row;    
+    uint8_t *in_rows[4] = {in_row_0, in_row_1, in_row_2, in_row_3};
+    int32_t num_blocks = out_w / num_c_mtx_row;
+    int32_t tail = out_w % num_c_mtx_row;   // outputs of a last, short block
 
-    for (int32_t i = 0; i < out_w / scale_factor; i++) {
-        // fill input vector
-        aie::vector<int16_t, 32> in_vec = aie::zeros<int16_t, 32>();
-        for (int32_t k_x = 0; k_x < 4; k_x++) {
-            
-            // clamp
-            int32_t in_x = i + k_x - 1;
-            if (in_x < 0) in_x = 0;
-            if (in_x > out_w/scale_factor - 1) in_x = out_w/scale_factor - 1;
-                    
-            for (int32_t p = 0; p < 2; p++) {
-                in_vec[16*p + k_x]      = in_row_0[in_x];
-                in_vec[16*p + 4 + k_x]  = in_row_1[in_x];
-                in_vec[16*p + 8 + k_x]  = in_row_2[in_x];
-                in_vec[16*p + 12 + k_x] = in_row_3[in_x];
-            }
-        }
+    // block i reads centers i * step .. i * step + (p - 1) * step / p: block 0
+    // starts on column 0, the last blocks may reach past in_w - 3
+    int32_t last_k_x0 = (num_c_mtx_row - 1) * c_mtx_step / num_c_mtx_row;
+    int32_t i0 = num_blocks < 1 ? num_blocks : 1;
+    int32_t i1 = num_blocks;
+    while (i1 > i0 && (i1 - 1) * c_mtx_step + last_k_x0 > in_w - 3) i1--;
 
-        for (int32_t mul_i = 0; mul_i < num_mul; mul_i++) {
-            // fill c_mtx_row vector
-            aie::vector<int16_t, 32> c_mtx_vec = aie::load_v<32>(c_mtx_row + 32*mul_i);
-            
-            // run the two convolutions
-            aie::accum<acc32, 32> s = aie::mul(in_vec, c_mtx_vec);
-            aie::vector<int32_t, 32> s_vec = aie::to_vector<int32_t>(s);
-           
-            bool odd_mul = mul_i == num_mul - 1 && num_c_mtx_row % 2;
-            int32_t num_p = odd_mul ? 1 : 2;
-            for (int32_t p = 0; p < num_p; p++) {
-                int32_t pixel = aie::reduce_add(s_vec.extract<16>(p));
-                int32_t sum = aie::reduce_add(c_mtx_vec.extract<16>(p));
-                
-                pixel /= sum;
-                if (pixel < 0)   pixel = 0;
-                if (pixel > 255) pixel = 255;
-                
-                out_row[num_c_mtx_row*i + 2*mul_i + p] = pixel;
-            }
-        } 
+    int32_t i = 0;
+    for (; i < i0; i++) {
+        conv2d4k_block<true>(in_rows, i, c_mtx_row, num_c_mtx_row, c_mtx_step, out_row, in_w, num_c_mtx_row);
+    }
+    for (; i < i1; i++) {
+        conv2d4k_block<false>(in_rows, i, c_mtx_row, num_c_mtx_row, c_mtx_step, out_row, in_w, num_c_mtx_row);
+    }
+    for (; i < num_blocks; i++) {
+        conv2d4k_block<true>(in_rows, i, c_mtx_row, num_c_mtx_row, c_mtx_step, out_row, in_w, num_c_mtx_row);
+    }
+    if (tail) {
+        conv2d4k_block<true>(in_rows, num_blocks, c_mtx_row, num_c_mtx_row, c_mtx_step, out_row, in_w, tail);
     }
 }
 #endif
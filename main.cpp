@@ -4,7 +4,9 @@
 #include <string.h>
 #include <cassert>
 #include <chrono>
+#include <atomic>
 #include <math.h>
+#include <new>
 
 #include "xrt/xrt_device.h"
 #include "xrt/xrt_kernel.h"
@@ -17,12 +19,69 @@
 
 #include <opencv2/opencv.hpp>
 
+#include "aie_ref.h"
+#include "decode_resize.h"
+#include "image_map.h"
+#include "image_write.h"
+#include "png_write.h"
+#include "resize.h"
+#include "resize_stream.h"
+#include "thread_pool.h"
+#include "yuv.h"
+
 #define INPUT_FILE "input.jpg"
-#define SCALE_FACTOR 2.0f   // must be an integer value
+// output = input * SCALE_NUM / SCALE_DEN, e.g. 3/2 for 720p -> 1080p
+#define SCALE_NUM 2
+#define SCALE_DEN 1
 
-#define INT_SCALE (1 << 12)
 #define A 2
 
+// frames per lanczos_aie_batch() run in main
+#define AIE_BATCH 8
+
+// Heap allocations made by this program's own objects: build.sh links with
+// -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc, so their calls land here,
+// and new / new[] are replaced below to go through the wrapped malloc
+static std::atomic<uint64_t> allocations(0);
+
+extern "C" {
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+void *__wrap_malloc(size_t size) {
+    allocations++;
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t count, size_t size) {
+    allocations++;
+    return __real_calloc(count, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+    allocations++;
+    return __real_realloc(ptr, size);
+}
+}
+
+// libstdc++'s own operator new calls malloc from inside the shared library,
+// where the wrap can't see it
+void *operator new(size_t size) {
+    void *ptr = malloc(size ? size : 1);
+    if (!ptr) throw std::bad_alloc();
+    return ptr;
+}
+
+void *operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void *ptr) noexcept { free(ptr); }
+void operator delete[](void *ptr) noexcept { free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { free(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { free(ptr); }
+
 std::vector<uint32_t> load_file(std::string file_path) {
     // Open file in binary mode
     std::ifstream file_stream(file_path, std::ios::binary);
@@ -49,99 +108,19 @@ std::vector<uint32_t> load_file(std::string file_path) {
 }
 
 
-void neareast_neightbor(
-    uint8_t *in_pixels, uint32_t in_w, uint32_t in_h,
-    uint8_t *out_pixels, uint32_t out_w, uint32_t out_h
-) {
-    double ratio_x = (double)out_w / in_w;
-    double ratio_y = (double)out_h / in_h;
-
-    for (uint32_t i = 0; i < out_w; i++) {
-        for (uint32_t j = 0; j < out_h; j++) {
-            uint32_t in_x = i / ratio_x;
-            uint32_t in_y = j / ratio_y;
-            
-            out_pixels[i + j * out_w] = in_pixels[in_x + in_y * in_w];
-        }
-    }
-}
-
-int32_t clamp(int32_t in, int32_t low, int32_t high) {
-    if (in < low) return low;
-    if (in > high) return high;
-    return in;
-}
-
-double lanczos_kernel(double x, int32_t a) {
-    if (x == 0.0f) return 1.0f;
-    return a * sin(M_PI * x) * sin(M_PI * x / a) / pow(x, 2) / pow(M_PI, 2);
-}
-
-uint8_t *lanczos(
-    uint8_t *in,
-    int32_t in_w,
-    int32_t in_h,
-    double scale_factor,
-    int32_t a
-) {
-    int32_t out_w = in_w * scale_factor;
-    int32_t out_h = in_h * scale_factor;
-    uint8_t *out = (uint8_t *)malloc(out_w * out_h * sizeof(uint8_t));
-    
-    if (!(a > 0)) {
-        printf("a=%i should be greater than 0\n", a);
-        return NULL;
-    }
-
-    double ratio_x = (double)in_w / out_w;
-    double ratio_y = (double)in_h / out_h;
-    
-    for (int32_t i = 0; i < out_w; i++) {
-        for (int32_t j = 0; j < out_h; j++) {
-            int32_t in_x = i * ratio_x;
-            int32_t in_y = j * ratio_y;
-
-            // convolve
-            int32_t sum = 0;
-            int32_t pixel = 0;
-            for (int32_t m = -a+1; m <= a; m++) {
-                for (int32_t n = -a+1; n <= a; n++) {
-                    double x = in_x - i * ratio_x + m;
-                    double y = in_y - j * ratio_y + n;
-                    
-                    int32_t weight = lanczos_kernel(x, a) * lanczos_kernel(y, a) * INT_SCALE;
-                    sum += weight;
-                                        
-                    int32_t real_in_x = clamp(in_x + m, 0, in_w - 1);
-                    int32_t real_in_y = clamp(in_y + n, 0, in_h - 1);
-                    
-                    int32_t idx = real_in_x + real_in_y * in_w;
-                    pixel += in[idx] * weight;
-                }
-            }
-
-            int32_t idx = i + j * out_w;
-            out[idx] = clamp((uint32_t)(pixel / sum), 0, 255);
-        }
-    }
-
-    return out;
-}
-
-uint8_t *lanczos_opencv(uint8_t *in, int32_t in_w, int32_t in_h, double scale_factor) {
-    int32_t out_w = in_w * scale_factor;
-    int32_t out_h = in_h * scale_factor;
+uint8_t *lanczos_opencv(uint8_t *in, int32_t in_w, int32_t in_h, int32_t num, int32_t den) {
+    int32_t out_w = (int64_t)in_w * num / den;
+    int32_t out_h = (int64_t)in_h * num / den;
     uint8_t *out = (uint8_t *)malloc(out_w * out_h * sizeof(uint8_t));
 
+    // wraps out, so cv::resize writes straight into it
     cv::Mat cv_in(in_h, in_w, CV_8UC1, in);
-    cv::Mat cv_out;
-    cv::resize(cv_in, cv_out, cv::Size(), scale_factor, scale_factor, cv::INTER_LANCZOS4);
-    
-    memcpy(out, cv_out.data, out_w * out_h);
+    cv::Mat cv_out(out_h, out_w, CV_8UC1, out);
+    cv::resize(cv_in, cv_out, cv::Size(out_w, out_h), 0, 0, cv::INTER_LANCZOS4);
     return out;
 }
 
-void build_aie(int32_t in_w, int32_t in_h, double scale_factor, bool scalar) {
+void build_aie(int32_t in_w, int32_t in_h, int32_t num, int32_t den, bool scalar) {
     char command[1024];
     sprintf(command, 
         "cd build && ${PEANO_INSTALL_DIR}/bin/clang++ \
@@ -159,7 +138,7 @@ void build_aie(int32_t in_w, int32_t in_h, double scale_factor, bool scalar) {
     );
     system(command);
 
-    sprintf(command, "cd build && python ../aie2.py %i %i %f > aie.mlir", in_w, in_h, scale_factor);
+    sprintf(command, "cd build && python ../aie2.py %i %i %i %i > aie.mlir", in_w, in_h, num, den);
     system(command);
     
     system(
@@ -175,7 +154,12 @@ void build_aie(int32_t in_w, int32_t in_h, double scale_factor, bool scalar) {
     );
 }
 
-uint8_t *lanczos_aie(uint8_t *in, int32_t in_w, int32_t in_h, double scale_factor) {
+#define AIE_BUFFERS 2
+
+// count images of the geometry the xclbin was built for: the device context,
+// instruction stream, coefficients and buffers are set up once. Two buffer
+// sets alternate, so image i + 1 is copied in and queued while image i runs
+void lanczos_aie_batch(uint8_t **in, uint8_t **out, int32_t count, int32_t in_w, int32_t in_h, int32_t num, int32_t den) {
     // Initialize device
     xrt::device device = xrt::device(0);
     
@@ -191,21 +175,23 @@ uint8_t *lanczos_aie(uint8_t *in, int32_t in_w, int32_t in_h, double scale_facto
     
     // set up the buffer objects
     int32_t in_size = in_w * in_h;
-    int32_t out_w = in_w * scale_factor;
-    int32_t out_h = in_h * scale_factor;
-    uint8_t *out = (uint8_t *)malloc(out_w * out_h * sizeof(uint8_t));
+    int32_t out_w = (int64_t)in_w * num / den;
+    int32_t out_h = (int64_t)in_h * num / den;
     int32_t out_size = out_w * out_h; 
 
     auto bo_instr = xrt::bo(device, instr_v.size() * sizeof(int),
                           XCL_BO_FLAGS_CACHEABLE, kernel.group_id(1));
-    auto in_buf = xrt::bo(device, in_size * sizeof(uint8_t),
-                        XRT_BO_FLAGS_HOST_ONLY, kernel.group_id(3));
-    auto out_buf = xrt::bo(device, out_size * sizeof(uint8_t),
-                         XRT_BO_FLAGS_HOST_ONLY, kernel.group_id(4));
+    xrt::bo in_buf[AIE_BUFFERS];
+    xrt::bo out_buf[AIE_BUFFERS];
+    for (int32_t b = 0; b < AIE_BUFFERS; b++) {
+        in_buf[b] = xrt::bo(device, in_size * sizeof(uint8_t),
+                            XRT_BO_FLAGS_HOST_ONLY, kernel.group_id(3));
+        out_buf[b] = xrt::bo(device, out_size * sizeof(uint8_t),
+                             XRT_BO_FLAGS_HOST_ONLY, kernel.group_id(4));
+    }
     
     // 4x4 convolution matrix
-    int32_t n_c_mtx = scale_factor;
-    int32_t c_mtx_size = 16 * n_c_mtx * n_c_mtx;
+    int32_t c_mtx_size = aie_c_mtx_size(num, den);
     auto c_mtx_buf = xrt::bo(device, c_mtx_size * sizeof(int16_t),
                          XRT_BO_FLAGS_HOST_ONLY, kernel.group_id(5));
 
@@ -213,121 +199,825 @@ uint8_t *lanczos_aie(uint8_t *in, int32_t in_w, int32_t in_h, double scale_facto
     void *instr_map = bo_instr.map<void *>();
     memcpy(instr_map, instr_v.data(), instr_v.size() * sizeof(int));
 
-    uint8_t *in_map = in_buf.map<uint8_t *>();
-    memcpy(in_map, in, in_size * sizeof(uint8_t));    
-
-    // Zero out buffer out_buf
-    uint8_t *out_map = out_buf.map<uint8_t *>();
-    memset(out_map, 0, out_size * sizeof(uint8_t));
-
     int16_t *c_mtx_map = c_mtx_buf.map<int16_t *>();
-    memset(c_mtx_map, 0, c_mtx_size * sizeof(int16_t));
-    
-    for (uint32_t x = 0; x < n_c_mtx; x++) {
-        for (uint32_t y = 0; y < n_c_mtx; y++) {
-            for (int32_t m = -A+1; m <= A; m++) {
-                for (int32_t n = -A+1; n <= A; n++) {
-                    uint32_t in_x = x / scale_factor;
-                    uint32_t in_y = y / scale_factor;
-
-                    double i = in_x - x * (1 / scale_factor) + m;
-                    double j = in_y - y * (1 / scale_factor) + n;
-                    
-                    double weight = lanczos_kernel(i, A) * lanczos_kernel(j, A); 
-                    uint32_t idx = (x + y * n_c_mtx) * 16 \
-                        + (n+1) * 2*A \
-                        + (m+1);
-                    
-                    //printf("x=%lf, x=%lf> w=%lf\n", i, j, weight);                    
-                    
-                    c_mtx_map[idx] = weight * INT_SCALE;
-                }
-            } 
-        }
-    }
+    aie_c_mtx_build(c_mtx_map, num, den);
 
     // sync host to device memories
     bo_instr.sync(XCL_BO_SYNC_BO_TO_DEVICE);
-    in_buf.sync(XCL_BO_SYNC_BO_TO_DEVICE);
-    out_buf.sync(XCL_BO_SYNC_BO_TO_DEVICE);
     c_mtx_buf.sync(XCL_BO_SYNC_BO_TO_DEVICE);
     
     unsigned int opcode = 3; // ??
 
-    auto run = kernel(
-        opcode,
-        bo_instr, instr_v.size(),
-        in_buf,
-        out_buf,
-        c_mtx_buf
-    );
-    run.wait();
-    
-    out_buf.sync(XCL_BO_SYNC_BO_FROM_DEVICE);
+    xrt::run runs[AIE_BUFFERS];
+    for (int32_t i = 0; i <= count; i++) {
+        // queue image i, then collect image i - 1 while it runs
+        if (i < count) {
+            int32_t b = i % AIE_BUFFERS;
+            memcpy(in_buf[b].map<uint8_t *>(), in[i], in_size * sizeof(uint8_t));
+            in_buf[b].sync(XCL_BO_SYNC_BO_TO_DEVICE);
+
+            runs[b] = kernel(
+                opcode,
+                bo_instr, instr_v.size(),
+                in_buf[b],
+                out_buf[b],
+                c_mtx_buf
+            );
+        }
+
+        if (i > 0) {
+            int32_t b = (i - 1) % AIE_BUFFERS;
+            runs[b].wait();
+            out_buf[b].sync(XCL_BO_SYNC_BO_FROM_DEVICE);
+            memcpy(out[i - 1], out_buf[b].map<uint8_t *>(), out_size);
+        }
+    }
+}
+
+uint8_t *lanczos_aie(uint8_t *in, int32_t in_w, int32_t in_h, int32_t num, int32_t den) {
+    int32_t out_w = (int64_t)in_w * num / den;
+    int32_t out_h = (int64_t)in_h * num / den;
+    uint8_t *out = (uint8_t *)malloc(out_w * out_h * sizeof(uint8_t));
 
-    memcpy(out, out_map, out_size);
+    lanczos_aie_batch(&in, &out, 1, in_w, in_h, num, den);
     return out;
 }
 
+// BT.601 full range, chroma averaged over each 2x2 block
+yuv_frame rgb_to_nv12(uint8_t *rgb, int32_t w, int32_t h) {
+    int32_t cw = yuv_chroma_size(w);
+    int32_t ch = yuv_chroma_size(h);
+
+    yuv_frame frame = { YUV_NV12, w, h, NULL, NULL, NULL, 0, 0 };
+    frame.y = (uint8_t *)malloc(w * h);
+    frame.u = (uint8_t *)malloc(cw * ch * 2);
+
+    for (int32_t i = 0; i < w * h; i++) {
+        uint8_t *px = rgb + 3 * i;
+        frame.y[i] = (77 * px[0] + 150 * px[1] + 29 * px[2] + 128) >> 8;
+    }
+
+    for (int32_t y = 0; y < ch; y++) {
+        for (int32_t x = 0; x < cw; x++) {
+            int32_t r = 0, g = 0, b = 0;
+            for (int32_t k = 0; k < 4; k++) {
+                uint8_t *px = rgb + 3 * (clamp(2 * y + k / 2, 0, h - 1) * w + clamp(2 * x + k % 2, 0, w - 1));
+                r += px[0];
+                g += px[1];
+                b += px[2];
+            }
+
+            frame.u[2 * (y * cw + x)]     = clamp((-43 * r - 85 * g + 128 * b + 512) / 1024 + 128, 0, 255);
+            frame.u[2 * (y * cw + x) + 1] = clamp((128 * r - 107 * g - 21 * b + 512) / 1024 + 128, 0, 255);
+        }
+    }
+    return frame;
+}
+
+// every SIMD variant the host supports has to match the scalar kernels bit
+// for bit, with the Lanczos A or another filter
+uint64_t check_simd(uint8_t *in, int32_t in_w, int32_t in_h, int32_t channels, int32_t num, int32_t den, int32_t a = A) {
+    resize_isa active = resize_get_isa();
+    int32_t out_size = (int32_t)((int64_t)in_w * num / den) * (int32_t)((int64_t)in_h * num / den) * channels;
+
+    resize_set_isa(ISA_SCALAR);
+    uint8_t *ref = lanczos_interleaved(in, in_w, in_h, channels, num, den, a);
+
+    uint64_t errors = 0;
+    for (int32_t isa = ISA_SCALAR + 1; isa < ISA_COUNT; isa++) {
+        if (!resize_set_isa((resize_isa)isa)) continue;
+
+        uint8_t *out = lanczos_interleaved(in, in_w, in_h, channels, num, den, a);
+        uint64_t isa_errors = 0;
+        for (int32_t i = 0; i < out_size; i++) {
+            if (out[i] != ref[i]) isa_errors++;
+        }
+        printf("%s errors: %lu\n", resize_isa_name((resize_isa)isa), isa_errors);
+
+        errors += isa_errors;
+        free(out);
+    }
+
+    free(ref);
+    resize_set_isa(active);
+    return errors;
+}
+
+// row by row through a lanczos_stream, pulling every output row as soon as
+// it's ready; has to match the whole frame resize
+uint64_t check_stream(uint8_t *in, int32_t in_w, int32_t in_h, uint8_t *ref) {
+    lanczos_stream *stream = lanczos_stream_create(in_w, in_h, 1, SCALE_NUM, SCALE_DEN, A);
+    uint8_t *out_row = (uint8_t *)malloc(stream->out_w);
+
+    uint64_t errors = 0;
+    int32_t y = 0;
+    for (int32_t in_y = 0; in_y < in_h; ) {
+        if (lanczos_stream_push(stream, in + in_y * in_w)) in_y++;
+
+        for (; lanczos_stream_pull(stream, out_row); y++) {
+            for (int32_t x = 0; x < stream->out_w; x++) {
+                if (out_row[x] != ref[y * stream->out_w + x]) errors++;
+            }
+        }
+    }
+    if (y != stream->out_h) errors++;
+
+    printf("stream errors: %lu, ring: %i rows\n", errors, stream->phases->taps);
+    free(out_row);
+    lanczos_stream_free(stream);
+    return errors;
+}
+
+// Every border mode against BORDER_CLAMP: the outputs may only differ within
+// a filter's reach of the edges, and the row stream has to give the same
+// frame. Also times each mode, padding the rows shouldn't cost anything
+uint64_t check_borders(uint8_t *in, int32_t in_w, int32_t in_h) {
+    static const char *names[] = { "clamp", "mirror", "wrap", "constant" };
+    int32_t out_w = (int64_t)in_w * SCALE_NUM / SCALE_DEN;
+    int32_t out_h = (int64_t)in_h * SCALE_NUM / SCALE_DEN;
+    // outputs further than this from the edges only see input pixels
+    int32_t margin = 2 * A * SCALE_NUM / SCALE_DEN + 2 * A + 1;
+
+    uint8_t *clamped = lanczos_rational(in, in_w, in_h, SCALE_NUM, SCALE_DEN, A);
+    uint8_t *out_row = (uint8_t *)malloc(out_w);
+
+    uint64_t errors = 0;
+    for (int32_t border = BORDER_CLAMP; border <= BORDER_CONSTANT; border++) {
+        auto start = std::chrono::high_resolution_clock::now();
+        uint8_t *out = lanczos_interleaved(in, in_w, in_h, 1, SCALE_NUM, SCALE_DEN, A, 0, (resize_border)border, 128);
+        auto stop = std::chrono::high_resolution_clock::now();
+        double ms = std::chrono::duration<double, std::milli>(stop - start).count();
+
+        uint64_t inner_errors = 0;
+        for (int32_t y = margin; y < out_h - margin; y++) {
+            for (int32_t x = margin; x < out_w - margin; x++) {
+                if (out[y * out_w + x] != clamped[y * out_w + x]) inner_errors++;
+            }
+        }
+
+        uint64_t stream_errors = 0;
+        lanczos_stream *stream = lanczos_stream_create(in_w, in_h, 1, SCALE_NUM, SCALE_DEN, A, (resize_border)border, 128);
+        if (stream) {
+            int32_t y = 0;
+            for (int32_t in_y = 0; in_y < in_h; ) {
+                if (lanczos_stream_push(stream, in + in_y * in_w)) in_y++;
+
+                for (; lanczos_stream_pull(stream, out_row); y++) {
+                    stream_errors += memcmp(out_row, out + y * out_w, out_w) != 0;
+                }
+            }
+            lanczos_stream_free(stream);
+        }
+
+        printf("border %-8s time: %6.1lf ms, interior errors: %lu, stream errors: %lu\n",
+            names[border], ms, inner_errors, stream_errors);
+        errors += inner_errors + stream_errors;
+        free(out);
+    }
+
+    // 2 columns at 3/7 make a 0x8 output: no last column to pad the rows or
+    // size the tile spans for
+    uint8_t narrow[2 * 20];
+    memset(narrow, 128, sizeof(narrow));
+    uint64_t narrow_errors = 0;
+    for (int32_t border = BORDER_CLAMP; border <= BORDER_CONSTANT; border++) {
+        narrow_errors += !lanczos_into(narrow, 2, 20, 2, out_row, 0, 1, 3, 7, A, 0, (resize_border)border, 128);
+        narrow_errors += !lanczos_into(narrow, 2, 2, 2, out_row, 0, 1, 3, 7, A, 0, (resize_border)border, 128);
+
+        lanczos_stream *stream = lanczos_stream_create(2, 20, 1, 3, 7, A, (resize_border)border, 128);
+        if (!stream) continue;
+
+        int32_t rows = 0;
+        for (int32_t in_y = 0; in_y < 20; ) {
+            if (lanczos_stream_push(stream, narrow + in_y * 2)) in_y++;
+            while (lanczos_stream_pull(stream, out_row)) rows++;
+        }
+        narrow_errors += rows != 8;
+        lanczos_stream_free(stream);
+    }
+    printf("border 2x20 at 3/7 errors: %lu\n", narrow_errors);
+    errors += narrow_errors;
+
+    // images without pixels are rejected before any bank or column table is
+    // built
+    uint8_t empty[4 * 4];
+    uint64_t size_errors = 0;
+    size_errors += lanczos_into(empty, 0, 4, 0, empty, 0, 1, 2, 1, A);
+    size_errors += lanczos_into(empty, -3, 4, 0, empty, 0, 1, 2, 1, A);
+    size_errors += lanczos_into(empty, 4, 0, 4, empty, 8, 1, 2, 1, A);
+    size_errors += nearest_into(empty, 0, 4, 0, empty, 0, 1, 2, 1);
+    yuv_frame empty_frame = { YUV_NV12, 0, 4, empty, empty, NULL, 0, 0 };
+    yuv_frame empty_out = { YUV_NV12, 0, 0, empty, empty, NULL, 0, 0 };
+    size_errors += lanczos_yuv420_into(&empty_frame, &empty_out, 2, 1, 0, 0);
+    printf("border invalid sizes accepted: %lu\n", size_errors);
+    errors += size_errors;
+
+    free(out_row);
+    free(clamped);
+    return errors;
+}
+
+// The image widened to uint16 (x 257) and float (/ 255), resized by the
+// float pipeline: outputs within a couple of 8-bit steps of the fixed point
+// result, and every ISA within rounding of the scalar kernels
+uint64_t check_wide(uint8_t *in, int32_t in_w, int32_t in_h, uint8_t *ref) {
+    int32_t out_w = (int64_t)in_w * SCALE_NUM / SCALE_DEN;
+    int32_t out_h = (int64_t)in_h * SCALE_NUM / SCALE_DEN;
+    int64_t in_size = (int64_t)in_w * in_h;
+    int64_t out_size = (int64_t)out_w * out_h;
+
+    uint16_t *in16 = (uint16_t *)malloc(in_size * sizeof(uint16_t));
+    float *in32 = (float *)malloc(in_size * sizeof(float));
+    for (int64_t i = 0; i < in_size; i++) {
+        in16[i] = in[i] * 257;
+        in32[i] = in[i] / 255.0f;
+    }
+
+    resize_isa active = resize_get_isa();
+    uint16_t *scalar16 = NULL;
+    float *scalar32 = NULL;
+    uint64_t errors = 0;
+    for (int32_t isa = ISA_SCALAR; isa < ISA_COUNT; isa++) {
+        if (!resize_set_isa((resize_isa)isa)) continue;
+
+        auto start = std::chrono::high_resolution_clock::now();
+        uint16_t *out16 = lanczos_interleaved(in16, in_w, in_h, 1, SCALE_NUM, SCALE_DEN, A);
+        auto mid = std::chrono::high_resolution_clock::now();
+        float *out32 = lanczos_interleaved(in32, in_w, in_h, 1, SCALE_NUM, SCALE_DEN, A);
+        auto stop = std::chrono::high_resolution_clock::now();
+        if (!scalar16) scalar16 = out16;
+        if (!scalar32) scalar32 = out32;
+
+        int32_t max_diff16 = 0;
+        float max_diff32 = 0;
+        uint64_t off8 = 0;
+        for (int64_t i = 0; i < out_size; i++) {
+            max_diff16 = std::max(max_diff16, abs(out16[i] - scalar16[i]));
+            max_diff32 = std::max(max_diff32, fabsf(out32[i] - scalar32[i]));
+            off8 += abs(out16[i] / 257.0f - ref[i]) > 2 || fabsf(std::min(std::max(out32[i], 0.0f), 1.0f) * 255 - ref[i]) > 2;
+        }
+        uint64_t isa_errors = off8 + (max_diff16 > 1) + (max_diff32 > 1e-5f);
+
+        printf("wide %-9s uint16: %6.1lf ms, float: %6.1lf ms, vs scalar: %i / %g, vs uint8 errors: %lu\n",
+            resize_isa_name((resize_isa)isa),
+            std::chrono::duration<double, std::milli>(mid - start).count(),
+            std::chrono::duration<double, std::milli>(stop - mid).count(),
+            max_diff16, max_diff32, off8);
+        errors += isa_errors;
+        if (out16 != scalar16) free(out16);
+        if (out32 != scalar32) free(out32);
+    }
+    resize_set_isa(active);
+
+    free(scalar16);
+    free(scalar32);
+    free(in16);
+    free(in32);
+    return errors;
+}
+
+// The image through files: written to a mapped PGM, mapped back, resized
+// straight from the mapping into a mapped sink, and again down the stream
+// releasing the rows behind it. Both sinks must match the in-memory result
+uint64_t check_mapped(uint8_t *in, int32_t in_w, int32_t in_h, uint8_t *ref) {
+    int32_t out_w = (int64_t)in_w * SCALE_NUM / SCALE_DEN;
+    int32_t out_h = (int64_t)in_h * SCALE_NUM / SCALE_DEN;
+
+    mapped_image source;
+    if (!image_map_create("mapped_in.pgm", IMAGE_PNM, in_w, in_h, 1, 1, &source)) return 1;
+    for (int32_t y = 0; y < in_h; y++) {
+        memcpy(source.pixels + (int64_t)y * source.stride, in + (int64_t)y * in_w, in_w);
+    }
+    image_unmap(&source);
+
+    mapped_image sink;
+    if (!image_map_read("mapped_in.pgm", &source)) return 1;
+    if (!image_map_create("mapped_out.pgm", IMAGE_PNM, out_w, out_h, 1, 1, &sink)) {
+        image_unmap(&source);
+        return 1;
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    lanczos_into(source.pixels, in_w, in_h, source.stride, sink.pixels, sink.stride, 1, SCALE_NUM, SCALE_DEN, A);
+    auto stop = std::chrono::high_resolution_clock::now();
+
+    uint64_t into_errors = 0;
+    for (int32_t y = 0; y < out_h; y++) {
+        into_errors += memcmp(sink.pixels + (int64_t)y * sink.stride, ref + (int64_t)y * out_w, out_w) != 0;
+    }
+    image_unmap(&sink);
+
+    uint64_t stream_errors = 0;
+    auto stream_start = std::chrono::high_resolution_clock::now();
+    lanczos_stream *stream = lanczos_stream_create(in_w, in_h, 1, SCALE_NUM, SCALE_DEN, A);
+    if (stream && image_map_create("mapped_stream.pgm", IMAGE_PNM, out_w, out_h, 1, 1, &sink)) {
+        // the ring keeps the window already filtered, so a pushed row is
+        // done with, and so is a pulled one
+        int32_t y = 0;
+        for (int32_t in_y = 0; in_y < in_h; ) {
+            if (lanczos_stream_push(stream, source.pixels + (int64_t)in_y * source.stride)) {
+                in_y++;
+                if (in_y % DEFAULT_TILE_ROWS == 0) image_release_rows(&source, in_y - DEFAULT_TILE_ROWS, in_y);
+            }
+            for (; lanczos_stream_pull(stream, sink.pixels + (int64_t)y * sink.stride); y++) {
+                stream_errors += memcmp(sink.pixels + (int64_t)y * sink.stride, ref + (int64_t)y * out_w, out_w) != 0;
+                if ((y + 1) % DEFAULT_TILE_ROWS == 0) image_release_rows(&sink, y + 1 - DEFAULT_TILE_ROWS, y + 1);
+            }
+        }
+        image_unmap(&sink);
+    } else {
+        stream_errors++;
+    }
+    auto stream_stop = std::chrono::high_resolution_clock::now();
+    if (stream) lanczos_stream_free(stream);
+    image_unmap(&source);
+
+    printf("mapped into time: %6.1lf ms, stream time: %6.1lf ms, errors: %lu / %lu\n",
+        std::chrono::duration<double, std::milli>(stop - start).count(),
+        std::chrono::duration<double, std::milli>(stream_stop - stream_start).count(),
+        into_errors, stream_errors);
+    return into_errors + stream_errors;
+}
+
+// steady state resizing into caller buffers (padded rows, like a frame pool
+// would hand out) must not touch the heap once the first frame warmed the
+// phase bank and the scratch rows
+uint64_t check_alloc(uint8_t *in, int32_t in_w, int32_t in_h, yuv_frame *nv12) {
+    const int32_t frames = 8;
+    int32_t out_w = (int64_t)in_w * SCALE_NUM / SCALE_DEN;
+    int32_t out_h = (int64_t)in_h * SCALE_NUM / SCALE_DEN;
+    int32_t out_stride = (out_w + 63) & ~63;
+    int32_t out_ch = yuv_chroma_size(out_h);
+
+    // NV12 chroma rows are 2 * ceil(out_w / 2) <= out_stride bytes
+    uint8_t *out = (uint8_t *)malloc((int64_t)out_stride * out_h);
+    uint8_t *uv = (uint8_t *)malloc((int64_t)out_stride * out_ch);
+    yuv_frame nv12_out = { YUV_NV12, 0, 0, out, uv, NULL, out_stride, out_stride };
+    lanczos_stream *stream = lanczos_stream_create(in_w, in_h, 1, SCALE_NUM, SCALE_DEN, A);
+
+    for (int32_t frame = 0; frame <= frames; frame++) {
+        // frame 0 is the warm-up
+        if (frame == 1) allocations = 0;
+
+        lanczos_into(in, in_w, in_h, in_w, out, out_stride, 1, SCALE_NUM, SCALE_DEN, A);
+        lanczos_yuv420_into(nv12, &nv12_out, SCALE_NUM, SCALE_DEN, A, 1);
+
+        // a = 0: nearest neighbor column tables
+        nearest_into(in, in_w, in_h, in_w, out, out_stride, 1, SCALE_NUM, SCALE_DEN);
+        lanczos_yuv420_into(nv12, &nv12_out, SCALE_NUM, SCALE_DEN, 0, 0);
+
+        lanczos_stream_reset(stream);
+        int32_t y = 0;
+        for (int32_t in_y = 0; in_y < in_h; ) {
+            if (lanczos_stream_push(stream, in + in_y * in_w)) in_y++;
+            while (lanczos_stream_pull(stream, out + y * out_stride)) y++;
+        }
+    }
+    uint64_t steady = allocations;
+    printf("allocations after warm-up: %lu in %i frames\n", steady, frames);
+
+    lanczos_stream_free(stream);
+    free(uv);
+    free(out);
+    return steady;
+}
+
+// scaling curve of the CPU path, doubling the thread count up to all cores
+void bench_threads(uint8_t *in, int32_t in_w, int32_t in_h, int32_t num, int32_t den) {
+    int32_t max_threads = thread_pool_participants(0);
+    double base_ms = 0;
+
+    for (int32_t threads = 1; ; threads *= 2) {
+        if (threads > max_threads) threads = max_threads;
+
+        auto start = std::chrono::high_resolution_clock::now();
+        uint8_t *out = lanczos_rational(in, in_w, in_h, num, den, A, threads);
+        auto stop = std::chrono::high_resolution_clock::now();
+        double ms = std::chrono::duration<double, std::milli>(stop - start).count();
+        free(out);
+
+        if (threads == 1) base_ms = ms;
+        printf("cpu threads: %3i, time: %6.1lf ms, speedup: %5.2lf\n", threads, ms, base_ms / ms);
+
+        if (threads == max_threads) break;
+    }
+}
+
+// Thumbnails: the image cut into THUMB x THUMB tiles (views with the image
+// stride, nothing copied), halved one call per tile and as one batch
+#define THUMB 128
+
+uint64_t bench_batch(uint8_t *in, int32_t in_w, int32_t in_h) {
+    int32_t cols = in_w / THUMB;
+    int32_t count = cols * (in_h / THUMB);
+    if (count == 0) return 0;
+
+    int32_t out_w = THUMB / 2;
+    uint8_t **tiles = (uint8_t **)malloc(count * sizeof(uint8_t *));
+    uint8_t **single = (uint8_t **)malloc(count * sizeof(uint8_t *));
+    uint8_t **batch = (uint8_t **)malloc(count * sizeof(uint8_t *));
+    for (int32_t i = 0; i < count; i++) {
+        tiles[i] = in + (int64_t)(i / cols) * THUMB * in_w + (i % cols) * THUMB;
+        single[i] = (uint8_t *)malloc(out_w * out_w);
+        batch[i] = (uint8_t *)malloc(out_w * out_w);
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int32_t i = 0; i < count; i++) {
+        lanczos_into(tiles[i], THUMB, THUMB, in_w, single[i], out_w, 1, 1, 2, A);
+    }
+    auto mid = std::chrono::high_resolution_clock::now();
+    lanczos_batch(tiles, THUMB, THUMB, in_w, batch, out_w, count, 1, 1, 2, A);
+    auto stop = std::chrono::high_resolution_clock::now();
+
+    uint64_t errors = 0;
+    for (int32_t i = 0; i < count; i++) {
+        errors += memcmp(single[i], batch[i], out_w * out_w) != 0;
+        free(single[i]);
+        free(batch[i]);
+    }
+
+    double single_s = std::chrono::duration<double>(mid - start).count();
+    double batch_s = std::chrono::duration<double>(stop - mid).count();
+    double mpixels = (double)count * THUMB * THUMB / 1e6;
+    printf("batch %i thumbnails %ix%i: single %.0lf img/s (%.0lf MP/s), batch %.0lf img/s (%.0lf MP/s), errors: %lu\n",
+        count, THUMB, THUMB, count / single_s, mpixels / single_s, count / batch_s, mpixels / batch_s, errors);
+
+    free(tiles);
+    free(single);
+    free(batch);
+    return errors;
+}
+
+// The image repeated side by side to TILE_BENCH_W columns: untiled against
+// the autotuned tiles, which have to match bit for bit
+#define TILE_BENCH_W 16384
+
+uint64_t bench_tiles(uint8_t *in, int32_t in_w, int32_t in_h) {
+    int32_t wide_w = TILE_BENCH_W / in_w * in_w;
+    if (wide_w == 0) return 0;
+    int32_t out_w = (int64_t)wide_w * SCALE_NUM / SCALE_DEN;
+    int32_t out_h = (int64_t)in_h * SCALE_NUM / SCALE_DEN;
+
+    uint8_t *wide = (uint8_t *)malloc((int64_t)wide_w * in_h);
+    for (int32_t y = 0; y < in_h; y++) {
+        for (int32_t x = 0; x < wide_w; x += in_w) {
+            memcpy(wide + (int64_t)y * wide_w + x, in + (int64_t)y * in_w, in_w);
+        }
+    }
+    uint8_t *untiled = (uint8_t *)malloc((int64_t)out_w * out_h);
+    uint8_t *tiled = (uint8_t *)malloc((int64_t)out_w * out_h);
+
+    resize_tile tile = resize_autotune();
+    resize_tile none = { 0, 0 };
+    resize_set_tile(none);
+    auto start = std::chrono::high_resolution_clock::now();
+    lanczos_into(wide, wide_w, in_h, wide_w, untiled, out_w, 1, SCALE_NUM, SCALE_DEN, A);
+    auto mid = std::chrono::high_resolution_clock::now();
+    resize_set_tile(tile);
+    lanczos_into(wide, wide_w, in_h, wide_w, tiled, out_w, 1, SCALE_NUM, SCALE_DEN, A);
+    auto stop = std::chrono::high_resolution_clock::now();
+
+    uint64_t errors = memcmp(untiled, tiled, (int64_t)out_w * out_h) != 0;
+    printf("tiles %ix%i: untiled %.1lf ms, %lld bytes x %i rows %.1lf ms, errors: %lu\n",
+        wide_w, in_h,
+        std::chrono::duration<double, std::milli>(mid - start).count(),
+        (long long)tile.bytes, tile.rows,
+        std::chrono::duration<double, std::milli>(stop - mid).count(),
+        errors);
+
+    free(wide);
+    free(untiled);
+    free(tiled);
+    return errors;
+}
+
+// the latency tiers: bilinear and bicubic through the same engine as
+// Lanczos, upscaling and downscaling, one thread
+void bench_filters(uint8_t *in, int32_t in_w, int32_t in_h) {
+    int32_t filters[3] = { FILTER_BILINEAR, FILTER_BICUBIC, A };
+    int32_t scales[2][2] = { { SCALE_NUM, SCALE_DEN }, { 1, 2 } };
+
+    for (int32_t s = 0; s < 2; s++) {
+        int32_t num = scales[s][0];
+        int32_t den = scales[s][1];
+        int32_t out_w = (int64_t)in_w * num / den;
+        int32_t out_h = (int64_t)in_h * num / den;
+        uint8_t *out = (uint8_t *)malloc((int64_t)out_w * out_h);
+        memset(out, 0xff, (int64_t)out_w * out_h);
+
+        double ms[3];
+        for (int32_t f = 0; f < 3; f++) {
+            auto start = std::chrono::high_resolution_clock::now();
+            lanczos_into(in, in_w, in_h, in_w, out, out_w, 1, num, den, filters[f], 1);
+            auto stop = std::chrono::high_resolution_clock::now();
+            ms[f] = std::chrono::duration<double, std::milli>(stop - start).count();
+        }
+        printf("filters x%i/%i (%s): bilinear %.1lf ms, bicubic %.1lf ms, lanczos a=%i %.1lf ms\n",
+            num, den, resize_isa_name(resize_get_isa()), ms[0], ms[1], A, ms[2]);
+        free(out);
+    }
+}
+
+// INPUT_FILE decoded then resized, against lanczos_decode() overlapping the
+// two: same output, and in about the time of the slower of the two
+uint64_t bench_decode(uint8_t *ref) {
+    auto start = std::chrono::high_resolution_clock::now();
+    int32_t w, h, c;
+    uint8_t *pixels = stbi_load(INPUT_FILE, &w, &h, &c, 1);
+    auto mid = std::chrono::high_resolution_clock::now();
+    // the resize lanczos_decode() does, on this thread
+    lanczos_stream *stream = lanczos_stream_create(w, h, 1, SCALE_NUM, SCALE_DEN, A);
+    uint8_t *serial = (uint8_t *)malloc((int64_t)stream->out_w * stream->out_h);
+    for (int32_t y = 0, out_y = 0; y < h || out_y < stream->out_h; ) {
+        if (y < h && lanczos_stream_push(stream, pixels + (int64_t)y * w)) {
+            y++;
+        } else if (lanczos_stream_pull(stream, serial + (int64_t)out_y * stream->out_w)) {
+            out_y++;
+        }
+    }
+    lanczos_stream_free(stream);
+    auto stop = std::chrono::high_resolution_clock::now();
+
+    int32_t out_w = 0, out_h = 0;
+    auto fused_start = std::chrono::high_resolution_clock::now();
+    uint8_t *fused = lanczos_decode(INPUT_FILE, 1, SCALE_NUM, SCALE_DEN, A, &out_w, &out_h);
+    auto fused_stop = std::chrono::high_resolution_clock::now();
+
+    int64_t out_size = (int64_t)out_w * out_h;
+    uint64_t errors = !fused || memcmp(fused, ref, out_size) != 0 || memcmp(serial, ref, out_size) != 0;
+    printf("decode %.1lf ms + stream %.1lf ms, fused %.1lf ms, errors: %lu\n",
+        std::chrono::duration<double, std::milli>(mid - start).count(),
+        std::chrono::duration<double, std::milli>(stop - mid).count(),
+        std::chrono::duration<double, std::milli>(fused_stop - fused_start).count(),
+        errors);
+
+    stbi_image_free(pixels);
+    free(serial);
+    free(fused);
+    return errors;
+}
+
+static double mb_per_s(int64_t bytes, std::chrono::high_resolution_clock::time_point start, std::chrono::high_resolution_clock::time_point stop) {
+    return bytes / 1e6 / std::chrono::duration<double>(stop - start).count();
+}
+
+// The output written by stbi_write_bmp against image_write() as BMP and PGM,
+// and streamed: resized row by row straight into an image_writer
+uint64_t bench_write(uint8_t *in, int32_t in_w, int32_t in_h, uint8_t *out) {
+    int32_t out_w = (int64_t)in_w * SCALE_NUM / SCALE_DEN;
+    int32_t out_h = (int64_t)in_h * SCALE_NUM / SCALE_DEN;
+    int64_t out_size = (int64_t)out_w * out_h;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    stbi_write_bmp("write_stb.bmp", out_w, out_h, 1, out);
+    auto stb = std::chrono::high_resolution_clock::now();
+    bool ok = image_write("write_bulk.bmp", IMAGE_BMP, out, out_w, out_h, 1, out_w);
+    auto bmp = std::chrono::high_resolution_clock::now();
+    ok &= image_write("write_bulk.pgm", IMAGE_PNM, out, out_w, out_h, 1, out_w);
+    auto pgm = std::chrono::high_resolution_clock::now();
+
+    lanczos_stream *stream = lanczos_stream_create(in_w, in_h, 1, SCALE_NUM, SCALE_DEN, A);
+    image_writer *writer = image_writer_open("write_stream.bmp", IMAGE_BMP, out_w, out_h, 1);
+    uint8_t *row = (uint8_t *)malloc(out_w);
+    for (int32_t y = 0; stream && writer && y < in_h; ) {
+        if (lanczos_stream_push(stream, in + (int64_t)y * in_w)) y++;
+        while (lanczos_stream_pull(stream, row)) image_writer_row(writer, row);
+    }
+    ok &= writer && image_writer_close(writer);
+    auto streamed = std::chrono::high_resolution_clock::now();
+    if (stream) lanczos_stream_free(stream);
+    free(row);
+
+    printf("write %ix%i: stb bmp %.0lf MB/s, bmp %.0lf MB/s, pgm %.0lf MB/s, resize + stream bmp %.1lf ms, errors: %i\n",
+        out_w, out_h,
+        mb_per_s(out_size, start, stb), mb_per_s(out_size, stb, bmp), mb_per_s(out_size, bmp, pgm),
+        std::chrono::duration<double, std::milli>(streamed - pgm).count(),
+        !ok);
+    return !ok;
+}
+
+// neareast_neightbor() as it was: a double division per pixel. Exact for
+// the factors bench_nearest() uses, whose ratios are exact doubles
+static void nearest_double(
+    uint8_t *in, uint32_t in_w, uint32_t in_h, int32_t channels,
+    uint8_t *out, uint32_t out_w, uint32_t out_h
+) {
+    double ratio_x = (double)out_w / in_w;
+    double ratio_y = (double)out_h / in_h;
+    for (uint32_t j = 0; j < out_h; j++) {
+        uint8_t *in_row = in + (int64_t)(uint32_t)(j / ratio_y) * in_w * channels;
+        uint8_t *out_row = out + (int64_t)j * out_w * channels;
+        for (uint32_t i = 0; i < out_w; i++) {
+            uint32_t in_x = i / ratio_x;
+            for (int32_t c = 0; c < channels; c++) {
+                out_row[i * channels + c] = in_row[in_x * channels + c];
+            }
+        }
+    }
+}
+
+// nearest_into() (index tables, shuffles, row copies) against the per
+// pixel division, upscaling by integer factors and downscaling by 2
+uint64_t bench_nearest(uint8_t *in, uint8_t *rgb_in, int32_t in_w, int32_t in_h) {
+    struct nearest_case { uint8_t *in; int32_t channels; int32_t num; int32_t den; };
+    nearest_case cases[] = { { in, 1, 2, 1 }, { in, 1, 4, 1 }, { rgb_in, 3, 2, 1 }, { in, 1, 1, 2 } };
+
+    uint64_t errors = 0;
+    for (nearest_case &n : cases) {
+        int32_t out_w = (int64_t)in_w * n.num / n.den;
+        int32_t out_h = (int64_t)in_h * n.num / n.den;
+        int64_t out_size = (int64_t)out_w * out_h * n.channels;
+        uint8_t *ref = (uint8_t *)malloc(out_size);
+        uint8_t *out = (uint8_t *)malloc(out_size);
+        memset(out, 0xff, out_size);    // page faults out of the timing
+
+        auto start = std::chrono::high_resolution_clock::now();
+        nearest_double(n.in, in_w, in_h, n.channels, ref, out_w, out_h);
+        auto mid = std::chrono::high_resolution_clock::now();
+        bool ok = nearest_into(n.in, in_w, in_h, in_w * n.channels, out, out_w * n.channels, n.channels, n.num, n.den, 1);
+        auto single = std::chrono::high_resolution_clock::now();
+        ok &= nearest_into(n.in, in_w, in_h, in_w * n.channels, out, out_w * n.channels, n.channels, n.num, n.den);
+        auto stop = std::chrono::high_resolution_clock::now();
+
+        uint64_t e = !ok || memcmp(ref, out, out_size) != 0;
+        printf("nearest x%i/%i, %i channels (%s): double %.1lf ms, tables %.1lf ms, all threads %.1lf ms, errors: %lu\n",
+            n.num, n.den, n.channels, resize_isa_name(resize_get_isa()),
+            std::chrono::duration<double, std::milli>(mid - start).count(),
+            std::chrono::duration<double, std::milli>(single - mid).count(),
+            std::chrono::duration<double, std::milli>(stop - single).count(),
+            e);
+        errors += e;
+        free(ref);
+        free(out);
+    }
+    return errors;
+}
+
+// The RGB output as PNG, stbi_write_png against png_write() deflating strips
+// on every core, both decoded back to check them
+uint64_t bench_png(uint8_t *out, int32_t out_w, int32_t out_h) {
+    int64_t out_size = (int64_t)out_w * out_h * 3;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    stbi_write_png("write_stb.png", out_w, out_h, 3, out, out_w * 3);
+    auto stb = std::chrono::high_resolution_clock::now();
+    bool ok = png_write("write_strips.png", out, out_w, out_h, 3, out_w * 3);
+    auto strips = std::chrono::high_resolution_clock::now();
+
+    uint64_t errors = !ok;
+    const char *paths[2] = { "write_stb.png", "write_strips.png" };
+    for (int32_t i = 0; i < 2; i++) {
+        int32_t w, h, c;
+        uint8_t *decoded = stbi_load(paths[i], &w, &h, &c, 3);
+        errors += !decoded || w != out_w || h != out_h || memcmp(decoded, out, out_size) != 0;
+        stbi_image_free(decoded);
+    }
+
+    printf("png %ix%i: stb %.0lf MB/s, strips on %i threads %.0lf MB/s, errors: %lu\n",
+        out_w, out_h,
+        mb_per_s(out_size, start, stb),
+        thread_pool_participants(0), mb_per_s(out_size, stb, strips),
+        errors);
+    return errors;
+}
+
 int main(void) {
-    // Load image
+    // Load image, luma only: the chroma blocks are skipped, not decoded
     int32_t w, h, c;
+    auto load_start = std::chrono::high_resolution_clock::now();
     uint8_t *pixels = stbi_load(INPUT_FILE, &w, &h, &c, 1);
+    auto load_stop = std::chrono::high_resolution_clock::now();
     assert(pixels != NULL && "failed to load the image");    
     
     uint32_t in_size = w * h;
-    uint32_t o_w = w * SCALE_FACTOR;
-    uint32_t o_h = h * SCALE_FACTOR;
+    uint32_t o_w = (int64_t)w * SCALE_NUM / SCALE_DEN;
+    uint32_t o_h = (int64_t)h * SCALE_NUM / SCALE_DEN;
     uint32_t out_size = o_w * o_h;
 
-    build_aie(w, h, SCALE_FACTOR, true);
+    build_aie(w, h, SCALE_NUM, SCALE_DEN, true);
     
     printf("w: %5i, h: %5i => o_w: %5i, o_h: %5i\n", w, h, o_w, o_h);
 
     // CPU
     auto start = std::chrono::high_resolution_clock::now();
-    uint8_t *c_out = lanczos(pixels, w, h, SCALE_FACTOR, 2);
+    uint8_t *c_out = lanczos_rational(pixels, w, h, SCALE_NUM, SCALE_DEN, 2);
     auto stop = std::chrono::high_resolution_clock::now();
     double ms = std::chrono::duration_cast<std::chrono::milliseconds>(stop - start).count();
-    printf("cpu time: %.0lf ms\n", ms);
+    printf("cpu (%s) time: %.0lf ms\n", resize_isa_name(resize_get_isa()), ms);
+
+    check_simd(pixels, w, h, 1, SCALE_NUM, SCALE_DEN);
+    check_simd(pixels, w, h, 1, 1, 4);  // downscaling, widened kernel
+    check_simd(pixels, w, h, 1, SCALE_NUM, SCALE_DEN, FILTER_BILINEAR);
+    check_simd(pixels, w, h, 1, 1, 3, FILTER_BICUBIC);
+    check_stream(pixels, w, h, c_out);
+    check_borders(pixels, w, h);
+    check_wide(pixels, w, h, c_out);
+    check_mapped(pixels, w, h, c_out);
+
+    // CPU, RGB in one interleaved pass
+    auto rgb_load_start = std::chrono::high_resolution_clock::now();
+    uint8_t *rgb_pixels = stbi_load(INPUT_FILE, &w, &h, &c, 3);
+    auto rgb_load_stop = std::chrono::high_resolution_clock::now();
+    assert(rgb_pixels != NULL && "failed to load the image");
+    printf("decode time: gray %.1lf ms, rgb %.1lf ms\n",
+        std::chrono::duration<double, std::milli>(load_stop - load_start).count(),
+        std::chrono::duration<double, std::milli>(rgb_load_stop - rgb_load_start).count());
+
+    start = std::chrono::high_resolution_clock::now();
+    uint8_t *c_rgb_out = lanczos_interleaved(rgb_pixels, w, h, 3, SCALE_NUM, SCALE_DEN, A);
+    stop = std::chrono::high_resolution_clock::now();
+    ms = std::chrono::duration_cast<std::chrono::milliseconds>(stop - start).count();
+    printf("cpu rgb (%s) time: %.0lf ms\n", resize_isa_name(resize_get_isa()), ms);
+
+    check_simd(rgb_pixels, w, h, 3, SCALE_NUM, SCALE_DEN);
+
+    // CPU, NV12 as decoded video comes: Lanczos on luma, a = 1 on chroma
+    yuv_frame nv12 = rgb_to_nv12(rgb_pixels, w, h);
+    yuv_frame nv12_out;
+
+    start = std::chrono::high_resolution_clock::now();
+    lanczos_yuv420(&nv12, &nv12_out, SCALE_NUM, SCALE_DEN, A, 1);
+    stop = std::chrono::high_resolution_clock::now();
+    ms = std::chrono::duration_cast<std::chrono::milliseconds>(stop - start).count();
+    printf("cpu nv12 (%s) time: %.0lf ms\n", resize_isa_name(resize_get_isa()), ms);
+
+    image_write("c_nv12_y_out.bmp", IMAGE_BMP, nv12_out.y, nv12_out.w, nv12_out.h, 1, nv12_out.y_stride ? nv12_out.y_stride : nv12_out.w);
+    check_alloc(pixels, w, h, &nv12);
+    yuv_frame_free(&nv12);
+    yuv_frame_free(&nv12_out);
+    bench_threads(pixels, w, h, SCALE_NUM, SCALE_DEN);
+    bench_batch(pixels, w, h);
+    bench_tiles(pixels, w, h);
+    bench_filters(pixels, w, h);
+    bench_decode(c_out);
+    bench_write(pixels, w, h, c_out);
+    bench_png(c_rgb_out, o_w, o_h);
+    bench_nearest(pixels, rgb_pixels, w, h);
+
+    // CPU reference of the AIE fixed-point arithmetic
+    start = std::chrono::high_resolution_clock::now();
+    uint8_t *ref_out = lanczos_aie_ref(pixels, w, h, SCALE_NUM, SCALE_DEN);
+    stop = std::chrono::high_resolution_clock::now();
+    ms = std::chrono::duration_cast<std::chrono::milliseconds>(stop - start).count();
+    printf("aie reference time: %.0lf ms\n", ms);
 
     // OpenCV
     start = std::chrono::high_resolution_clock::now();
-    uint8_t *cv_out = lanczos_opencv(pixels, w, h, SCALE_FACTOR); 
+    uint8_t *cv_out = lanczos_opencv(pixels, w, h, SCALE_NUM, SCALE_DEN); 
     stop = std::chrono::high_resolution_clock::now();
     ms = std::chrono::duration_cast<std::chrono::milliseconds>(stop - start).count();
     printf("opencv time: %.0lf ms\n", ms);
 
-    build_aie(w, h, SCALE_FACTOR, true);
+    build_aie(w, h, SCALE_NUM, SCALE_DEN, true);
     
     // AIE Scalar
     start = std::chrono::high_resolution_clock::now();
-    uint8_t *aie_sca_out = lanczos_aie(pixels, w, h, SCALE_FACTOR);    
+    uint8_t *aie_sca_out = lanczos_aie(pixels, w, h, SCALE_NUM, SCALE_DEN);    
     stop = std::chrono::high_resolution_clock::now();
     ms = std::chrono::duration_cast<std::chrono::milliseconds>(stop - start).count();
     printf("aie scalar time: %.0lf ms\n", ms);
 
-    build_aie(w, h, SCALE_FACTOR, false);
+    build_aie(w, h, SCALE_NUM, SCALE_DEN, false);
     
     // AIE Vector
     start = std::chrono::high_resolution_clock::now();
-    uint8_t *aie_vec_out = lanczos_aie(pixels, w, h, SCALE_FACTOR);    
+    uint8_t *aie_vec_out = lanczos_aie(pixels, w, h, SCALE_NUM, SCALE_DEN);    
     stop = std::chrono::high_resolution_clock::now();
     ms = std::chrono::duration_cast<std::chrono::milliseconds>(stop - start).count();
     printf("aie vector time: %.0lf ms\n", ms);
 
+    // AIE Vector, the device set up once for a batch of frames
+    uint8_t *aie_batch_in[AIE_BATCH];
+    uint8_t *aie_batch_out[AIE_BATCH];
+    for (int32_t i = 0; i < AIE_BATCH; i++) {
+        aie_batch_in[i] = pixels;
+        aie_batch_out[i] = (uint8_t *)malloc(out_size);
+    }
+    start = std::chrono::high_resolution_clock::now();
+    lanczos_aie_batch(aie_batch_in, aie_batch_out, AIE_BATCH, w, h, SCALE_NUM, SCALE_DEN);
+    stop = std::chrono::high_resolution_clock::now();
+    ms = std::chrono::duration<double, std::milli>(stop - start).count();
+    printf("aie vector batch of %i: %.1lf frames/s (%.0lf MP/s out)\n",
+        AIE_BATCH, AIE_BATCH * 1000.0 / ms, AIE_BATCH * (double)out_size / 1e3 / ms);
+    for (int32_t i = 0; i < AIE_BATCH; i++) {
+        free(aie_batch_out[i]);
+    }
+
     //neareast_neightbor(pixels, w, h, ref, o_w, o_h);
-    stbi_write_bmp("c_out.bmp", o_w, o_h, 1, c_out);
-    stbi_write_bmp("aie_sca_out.bmp", o_w, o_h, 1, aie_sca_out);
-    stbi_write_bmp("aie_vec_out.bmp", o_w, o_h, 1, aie_vec_out);
-    stbi_write_bmp("cv_out.bmp", o_w, o_h, 1, cv_out);
+    image_write("c_out.bmp", IMAGE_BMP, c_out, o_w, o_h, 1, o_w);
+    image_write("c_rgb_out.bmp", IMAGE_BMP, c_rgb_out, o_w, o_h, 3, o_w * 3);
+    image_write("ref_out.bmp", IMAGE_BMP, ref_out, o_w, o_h, 1, o_w);
+    image_write("aie_sca_out.bmp", IMAGE_BMP, aie_sca_out, o_w, o_h, 1, o_w);
+    image_write("aie_vec_out.bmp", IMAGE_BMP, aie_vec_out, o_w, o_h, 1, o_w);
+    image_write("cv_out.bmp", IMAGE_BMP, cv_out, o_w, o_h, 1, o_w);
 
     uint64_t errors = 0;
     int32_t err_x = -1;
     int32_t err_y = -1;
     for (size_t y = 0; y < o_h; y++) {
         for (size_t x = 0; x < o_w; x++) {
-            if (c_out[x + y * o_w] != aie_vec_out[x + y * o_w]) {
+            if (ref_out[x + y * o_w] != aie_vec_out[x + y * o_w]) {
                 err_x = x;
                 err_y = y;
                 errors++;
@@ -343,5 +1033,14 @@ int main(void) {
         printf("last error at x: %i, y: %i\n", err_x, err_y);
     }
 
+    free(c_out);
+    free(c_rgb_out);
+    free(ref_out);
+    free(cv_out);
+    free(aie_sca_out);
+    free(aie_vec_out);
+    stbi_image_free(rgb_pixels);
+    stbi_image_free(pixels);
+
     return 0;
 }
@@ -0,0 +1,245 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <stb_image_write.h>
+
+#include "png_write.h"
+#include "thread_pool.h"
+
+#define ADLER_MOD 65521
+#define ADLER_BLOCK 5552    // bytes summed before s2 could overflow
+
+// IDAT chunk length, type and CRC around the payload
+#define CHUNK_OVERHEAD 12
+
+struct png_strip {
+    uint8_t *deflate;   // raw deflate blocks, NULL if they couldn't be made
+    int32_t size;
+    uint32_t adler;     // of the filtered rows
+    int64_t offset;     // of its IDAT chunk in the file
+};
+
+struct png_job {
+    const uint8_t *pixels;
+    int32_t w;
+    int32_t h;
+    int32_t channels;
+    int32_t stride;
+    int32_t strip_rows;
+    int32_t num_strips;
+    png_strip *strips;
+    uint32_t adler;     // of the whole zlib stream
+    uint8_t *file;
+};
+
+struct crc_tables {
+    uint32_t crc[256];
+};
+
+// built by the compiler, so concurrent png_write() calls share it read-only
+static constexpr crc_tables crc_build() {
+    crc_tables table = {};
+    for (uint32_t n = 0; n < 256; n++) {
+        uint32_t c = n;
+        for (int32_t k = 0; k < 8; k++) {
+            c = c & 1 ? 0xedb88320 ^ (c >> 1) : c >> 1;
+        }
+        table.crc[n] = c;
+    }
+    return table;
+}
+
+static constexpr crc_tables crc_table = crc_build();
+
+static uint32_t crc32(const uint8_t *data, int64_t len) {
+    uint32_t c = 0xffffffff;
+    for (int64_t i = 0; i < len; i++) {
+        c = crc_table.crc[(c ^ data[i]) & 0xff] ^ (c >> 8);
+    }
+    return c ^ 0xffffffff;
+}
+
+static uint32_t adler32(const uint8_t *data, int64_t len) {
+    uint32_t s1 = 1;
+    uint32_t s2 = 0;
+    while (len > 0) {
+        int64_t block = len < ADLER_BLOCK ? len : ADLER_BLOCK;
+        for (int64_t i = 0; i < block; i++) {
+            s1 += data[i];
+            s2 += s1;
+        }
+        s1 %= ADLER_MOD;
+        s2 %= ADLER_MOD;
+        data += block;
+        len -= block;
+    }
+    return s2 << 16 | s1;
+}
+
+// Adler-32 of a followed by b, from theirs and the length of b: every byte
+// of b adds the s1 of a to s2 once more
+static uint32_t adler32_combine(uint32_t a, uint32_t b, int64_t len_b) {
+    uint32_t rem = len_b % ADLER_MOD;
+    uint32_t a1 = a & 0xffff;
+    uint32_t s1 = (a1 + (b & 0xffff) + ADLER_MOD - 1) % ADLER_MOD;
+    uint32_t s2 = ((uint64_t)rem * a1 + (a >> 16) + (b >> 16) + ADLER_MOD - rem) % ADLER_MOD;
+    return s2 << 16 | s1;
+}
+
+static uint8_t *put32(uint8_t *p, uint32_t value) {
+    p[0] = value >> 24;
+    p[1] = value >> 16;
+    p[2] = value >> 8;
+    p[3] = value;
+    return p + 4;
+}
+
+static int32_t strip_y0(png_job *job, int32_t strip) {
+    return strip * job->strip_rows;
+}
+
+static int32_t strip_y1(png_job *job, int32_t strip) {
+    int32_t y1 = (strip + 1) * job->strip_rows;
+    return y1 < job->h ? y1 : job->h;
+}
+
+static void deflate_strip(int32_t task, int32_t, void *ctx) {
+    png_job *job = (png_job *)ctx;
+    png_strip *strip = &job->strips[task];
+    int32_t y0 = strip_y0(job, task);
+    int32_t y1 = strip_y1(job, task);
+    int32_t len = (y1 - y0) * (job->w * job->channels + 1);
+
+    strip->deflate = NULL;
+    uint8_t *filtered = (uint8_t *)malloc(len);
+    if (!filtered) return;
+    if (!stbi_write_png_filter_rows(job->pixels, job->stride, job->w, job->h, job->channels, y0, y1, filtered)) {
+        free(filtered);
+        return;
+    }
+
+    strip->adler = adler32(filtered, len);
+    strip->deflate = stbi_zlib_deflate_blocks(filtered, len, &strip->size,
+        stbi_write_png_compression_level, task == job->num_strips - 1);
+    free(filtered);
+}
+
+// bytes of the IDAT payload of a strip: the zlib header goes in front of the
+// first one, the Adler-32 after the last
+static int64_t strip_payload(png_job *job, int32_t strip) {
+    return (strip == 0 ? 2 : 0) + job->strips[strip].size + (strip == job->num_strips - 1 ? 4 : 0);
+}
+
+static void write_chunk(int32_t task, int32_t, void *ctx) {
+    png_job *job = (png_job *)ctx;
+    png_strip *strip = &job->strips[task];
+    int64_t payload = strip_payload(job, task);
+
+    uint8_t *chunk = job->file + strip->offset;
+    uint8_t *p = put32(chunk, payload);
+    memcpy(p, "IDAT", 4);
+    p += 4;
+    if (task == 0) {
+        *p++ = 0x78;    // deflate, 32K window
+        *p++ = 0x5e;
+    }
+    memcpy(p, strip->deflate, strip->size);
+    p += strip->size;
+    if (task == job->num_strips - 1) p = put32(p, job->adler);
+    put32(p, crc32(chunk + 4, payload + 4));
+
+    free(strip->deflate);
+    strip->deflate = NULL;
+}
+
+bool png_write(
+    const char *path,
+    const uint8_t *pixels,
+    int32_t w,
+    int32_t h,
+    int32_t channels,
+    int32_t stride,
+    int32_t threads
+) {
+    if (w <= 0 || h <= 0 || channels < 1 || channels > 4) {
+        printf("invalid PNG %s: %ix%ix%i\n", path, w, h, channels);
+        return false;
+    }
+
+    int32_t row_bytes = w * channels + 1;
+    png_job job;
+    job.pixels = pixels;
+    job.w = w;
+    job.h = h;
+    job.channels = channels;
+    job.stride = stride;
+    job.strip_rows = PNG_STRIP_BYTES / row_bytes > 0 ? PNG_STRIP_BYTES / row_bytes : 1;
+    job.num_strips = (h + job.strip_rows - 1) / job.strip_rows;
+    job.strips = (png_strip *)malloc(job.num_strips * sizeof(png_strip));
+    if (!job.strips) {
+        printf("can't allocate %s\n", path);
+        return false;
+    }
+
+    thread_pool_run(job.num_strips, threads, deflate_strip, &job);
+
+    // chunk offsets after the signature and IHDR, and the stream's Adler-32
+    bool ok = true;
+    int64_t offset = 8 + CHUNK_OVERHEAD + 13;
+    job.adler = 1;
+    for (int32_t i = 0; i < job.num_strips; i++) {
+        ok &= job.strips[i].deflate != NULL;
+        if (!ok) continue;
+
+        int64_t len = (int64_t)(strip_y1(&job, i) - strip_y0(&job, i)) * row_bytes;
+        job.adler = adler32_combine(job.adler, job.strips[i].adler, len);
+        job.strips[i].offset = offset;
+        offset += CHUNK_OVERHEAD + strip_payload(&job, i);
+    }
+    if (!ok) {
+        printf("can't compress %s\n", path);
+        for (int32_t i = 0; i < job.num_strips; i++) free(job.strips[i].deflate);
+        free(job.strips);
+        return false;
+    }
+
+    int64_t size = offset + CHUNK_OVERHEAD;
+    job.file = (uint8_t *)malloc(size);
+    if (!job.file) {
+        printf("can't allocate %s\n", path);
+        for (int32_t i = 0; i < job.num_strips; i++) free(job.strips[i].deflate);
+        free(job.strips);
+        return false;
+    }
+
+    static const uint8_t signature[8] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+    static const uint8_t color_type[5] = { 0, 0, 4, 2, 6 };
+    uint8_t *p = job.file;
+    memcpy(p, signature, 8);
+    p = put32(p + 8, 13);
+    memcpy(p, "IHDR", 4);
+    p = put32(p + 4, w);
+    p = put32(p, h);
+    *p++ = 8;       // bits per sample
+    *p++ = color_type[channels];
+    *p++ = 0;       // deflate
+    *p++ = 0;       // adaptive filtering
+    *p++ = 0;       // not interlaced
+    put32(p, crc32(job.file + 12, 17));
+
+    thread_pool_run(job.num_strips, threads, write_chunk, &job);
+
+    p = put32(job.file + offset, 0);
+    memcpy(p, "IEND", 4);
+    put32(p + 4, crc32(p, 4));
+
+    FILE *f = fopen(path, "wb");
+    ok = f && fwrite(job.file, 1, size, f) == (size_t)size;
+    if (f) ok &= fclose(f) == 0;
+    if (!ok) printf("can't write %s\n", path);
+
+    free(job.file);
+    free(job.strips);
+    return ok;
+}
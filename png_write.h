@@ -0,0 +1,27 @@
+#pragma once
+
+// PNG encoding split into strips of rows that are filtered and deflated on
+// the thread pool, each into deflate blocks ending in a sync flush, so the
+// strips concatenate into the single zlib stream of the IDAT chunks. The
+// Adler-32 of the stream is combined from the ones of the strips. Uses the
+// filter and deflate of stb_image_write, so it compresses like
+// stbi_write_png() apart from matches not reaching across strips
+
+#include <stdint.h>
+
+// rows per strip are picked so a strip filters to about this many bytes
+#define PNG_STRIP_BYTES (256 * 1024)
+
+// Writes the w x h image of channels (1 to 4: gray, gray + alpha, RGB,
+// RGBA) interleaved samples per pixel, rows stride bytes apart, to path.
+// threads as for lanczos_interleaved(). False if the image is invalid or
+// the file can't be written
+bool png_write(
+    const char *path,
+    const uint8_t *pixels,
+    int32_t w,
+    int32_t h,
+    int32_t channels,
+    int32_t stride,
+    int32_t threads = 0
+);
@@ -0,0 +1,1207 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <mutex>
+
+#include "resize.h"
+#include "resize_kernels.h"
+#include "thread_pool.h"
+
+// output rows per strip: enough strips per thread to balance, but not so
+// small that recomputing the halo rows dominates. With a batch of images
+// the strips are spread over all of them, so a batch of at least
+// STRIPS_PER_THREAD images per thread runs whole images as strips
+#define MIN_STRIP_ROWS 16
+#define STRIPS_PER_THREAD 4
+
+static int32_t strip_rows(int32_t out_h, int32_t threads, int32_t images = 1) {
+    int32_t participants = thread_pool_participants(threads);
+    int64_t rows = ((int64_t)out_h * images + participants * STRIPS_PER_THREAD - 1) / (participants * STRIPS_PER_THREAD);
+    if (rows > out_h) rows = out_h;
+    return rows < MIN_STRIP_ROWS ? MIN_STRIP_ROWS : rows;
+}
+
+struct nearest_job {
+    uint8_t *in_pixels;
+    uint32_t in_h;
+    int32_t in_stride;
+    uint8_t *out_pixels;
+    uint32_t out_h;
+    int32_t out_stride;
+    int32_t strip_rows;
+    nearest_columns *columns;
+    nearest_row_fn row;
+};
+
+static nearest_columns *nearest_columns_build(int32_t in_w, int32_t out_w, int32_t channels) {
+    nearest_columns *columns = (nearest_columns *)malloc(sizeof(nearest_columns));
+    columns->in_w = in_w;
+    columns->out_w = out_w;
+    columns->channels = channels;
+    columns->src = (int32_t *)malloc(out_w * sizeof(int32_t));
+    for (int32_t x = 0; x < out_w; x++) {
+        columns->src[x] = (int64_t)x * in_w / out_w * channels;
+    }
+
+    columns->factor = 0;
+    columns->start = NULL;
+    columns->masks = NULL;
+    columns->masks_wide = NULL;
+    columns->simd_blocks = 0;
+    columns->wide_blocks = 0;
+    int32_t factor = out_w / in_w;
+    if (out_w % in_w != 0 || factor < 2 || factor > NEAREST_MAX_FACTOR) return columns;
+
+    // output bytes per input pixel, after which the shuffles line up again
+    int32_t pixel_bytes = channels * factor;
+    columns->factor = factor;
+    columns->period = 4 * pixel_bytes / gcd(16, pixel_bytes);
+    columns->advance = columns->period * 16 / pixel_bytes * channels;
+    columns->start = (int32_t *)malloc(columns->period * sizeof(int32_t));
+    columns->masks = (int8_t *)malloc(columns->period * 16);
+    for (int32_t b = 0; b < columns->period; b++) {
+        columns->start[b] = b * 16 / pixel_bytes * channels;
+        for (int32_t k = 0; k < 16; k++) {
+            int32_t o = b * 16 + k;
+            columns->masks[b * 16 + k] = o / pixel_bytes * channels + o % channels - columns->start[b];
+        }
+    }
+
+    int64_t blocks = (int64_t)out_w * channels / 16;
+    while (blocks > 0 && (blocks - 1) * 16 / pixel_bytes * channels + 16 > (int64_t)in_w * channels) blocks--;
+    columns->simd_blocks = blocks;
+
+    // 4 blocks read at most 48 / factor + 16 + channels bytes past the
+    // start of the first, within one 64 byte load
+    columns->masks_wide = (int8_t *)malloc(columns->period * 16);
+    for (int32_t b = 0; b < columns->period; b++) {
+        int32_t first = b / 4 * 4;
+        for (int32_t k = 0; k < 16; k++) {
+            columns->masks_wide[b * 16 + k] = columns->masks[b * 16 + k] + columns->start[b] - columns->start[first];
+        }
+    }
+
+    int64_t wide = blocks / 4 * 4;
+    while (wide > 0 && (wide - 4) * 16 / pixel_bytes * channels + 64 > (int64_t)in_w * channels) wide -= 4;
+    columns->wide_blocks = wide;
+    return columns;
+}
+
+static void nearest_columns_free(nearest_columns *columns) {
+    free(columns->src);
+    free(columns->start);
+    free(columns->masks);
+    free(columns->masks_wide);
+    free(columns);
+}
+
+// Column tables are kept for the life of the process like the phase banks,
+// see lanczos_phases_cached(), so nearest neighbor doesn't allocate once a
+// geometry has been seen
+static nearest_columns *columns_lookup(nearest_columns **cache, int32_t count, int32_t in_w, int32_t out_w, int32_t channels) {
+    for (int32_t i = 0; i < count; i++) {
+        nearest_columns *c = cache[i];
+        if (c->in_w == in_w && c->out_w == out_w && c->channels == channels) return c;
+    }
+    return NULL;
+}
+
+static nearest_columns *nearest_columns_cached(int32_t in_w, int32_t out_w, int32_t channels) {
+    static nearest_columns **cache = NULL;
+    static int32_t count = 0;
+    static int32_t capacity = 0;
+    static std::mutex mutex;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        nearest_columns *found = columns_lookup(cache, count, in_w, out_w, channels);
+        if (found) return found;
+    }
+
+    nearest_columns *columns = nearest_columns_build(in_w, out_w, channels);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    nearest_columns *found = columns_lookup(cache, count, in_w, out_w, channels);
+    if (found) {
+        nearest_columns_free(columns);
+        return found;
+    }
+    if (count == capacity) {
+        capacity = capacity ? 2 * capacity : 8;
+        cache = (nearest_columns **)realloc(cache, capacity * sizeof(nearest_columns *));
+    }
+    cache[count++] = columns;
+    return columns;
+}
+
+static void nearest_strip(int32_t strip, int32_t, void *ctx) {
+    nearest_job *job = (nearest_job *)ctx;
+    int32_t row_bytes = job->columns->out_w * job->columns->channels;
+
+    uint32_t j0 = strip * job->strip_rows;
+    uint32_t j1 = j0 + job->strip_rows < job->out_h ? j0 + job->strip_rows : job->out_h;
+
+    // row-major so the output is written sequentially. An input row repeated
+    // when upscaling is copied from the output row before it
+    int64_t prev_y = -1;
+    for (uint32_t j = j0; j < j1; j++) {
+        int64_t in_y = (uint64_t)j * job->in_h / job->out_h;
+        uint8_t *out_row = job->out_pixels + (int64_t)j * job->out_stride;
+        if (in_y == prev_y) {
+            memcpy(out_row, out_row - job->out_stride, row_bytes);
+        } else {
+            job->row(job->in_pixels + in_y * job->in_stride, out_row, job->columns);
+        }
+        prev_y = in_y;
+    }
+}
+
+static void nearest_run(
+    uint8_t *in_pixels, uint32_t in_w, uint32_t in_h, int32_t in_stride, int32_t channels,
+    uint8_t *out_pixels, uint32_t out_w, uint32_t out_h, int32_t out_stride,
+    int32_t threads
+) {
+    nearest_job job = { in_pixels, in_h, in_stride, out_pixels, out_h, out_stride, 0, NULL, nearest_row_active() };
+    job.strip_rows = strip_rows(out_h, threads);
+    job.columns = nearest_columns_cached(in_w, out_w, channels);
+
+    int32_t num_strips = (out_h + job.strip_rows - 1) / job.strip_rows;
+    thread_pool_run(num_strips, threads, nearest_strip, &job);
+}
+
+void neareast_neightbor(
+    uint8_t *in_pixels, uint32_t in_w, uint32_t in_h,
+    uint8_t *out_pixels, uint32_t out_w, uint32_t out_h,
+    int32_t threads
+) {
+    nearest_run(in_pixels, in_w, in_h, in_w, 1, out_pixels, out_w, out_h, out_w, threads);
+}
+
+int32_t clamp(int32_t in, int32_t low, int32_t high) {
+    if (in < low) return low;
+    if (in > high) return high;
+    return in;
+}
+
+int32_t border_index(int32_t i, int32_t n, resize_border border) {
+    if (i >= 0 && i < n) return i;
+
+    switch (border) {
+    case BORDER_MIRROR: {
+        if (n == 1) return 0;
+        int32_t period = 2 * (n - 1);
+        int32_t m = (i % period + period) % period;
+        return m < n ? m : period - m;
+    }
+    case BORDER_WRAP:
+        return (i % n + n) % n;
+    case BORDER_CONSTANT:
+        return -1;
+    default:
+        return clamp(i, 0, n - 1);
+    }
+}
+
+// widest load of any kernel: the interleaved ones read 16 bytes for the
+// last 4 taps
+static int32_t load_width(lanczos_phases *phases) {
+    return phases->stride + 16;
+}
+
+int32_t border_pad(lanczos_phases *phases, int32_t in_w, int32_t out_w) {
+    // no output column, no phase to reach past the row
+    if (out_w < 1) return 0;
+
+    int32_t width = load_width(phases);
+    int32_t pad = -phase_start(phases, 0);
+    int32_t right = phase_start(phases, out_w - 1) + width - in_w;
+    if (right > pad) pad = right;
+    return pad > 0 ? pad : 0;
+}
+
+// columns [x0, x1) outside the row of a padded row view
+template <typename T>
+static void border_fill(
+    T *in_row, int32_t in_w, int32_t channels, int32_t x0, int32_t x1,
+    resize_border border, T value, T *dst
+) {
+    for (int32_t x = x0; x < x1; x++, dst += channels) {
+        int32_t in_x = border_index(x, in_w, border);
+        for (int32_t c = 0; c < channels; c++) {
+            dst[c] = in_x < 0 ? value : in_row[in_x * channels + c];
+        }
+    }
+}
+
+// columns [x0, x1) of the row with the border applied, into dst
+template <typename T>
+static void border_span(
+    T *in_row, int32_t in_w, int32_t channels, int32_t x0, int32_t x1,
+    resize_border border, T value, T *dst
+) {
+    int32_t inside0 = x0 > 0 ? x0 : 0;
+    int32_t inside1 = x1 < in_w ? x1 : in_w;
+    int32_t left = x1 < 0 ? x1 : 0;
+    int32_t right = x0 > in_w ? x0 : in_w;
+
+    border_fill(in_row, in_w, channels, x0, left, border, value, dst);
+    if (inside0 < inside1) {
+        memcpy(dst + (inside0 - x0) * channels, in_row + inside0 * channels, (int64_t)(inside1 - inside0) * channels * sizeof(T));
+    }
+    if (right < x1) {
+        border_fill(in_row, in_w, channels, right, x1, border, value, dst + (right - x0) * channels);
+    }
+}
+
+template <typename T>
+void border_pad_row(
+    T *in_row, int32_t in_w, int32_t channels, int32_t pad,
+    resize_border border, T value, T *padded
+) {
+    border_span(in_row, in_w, channels, -pad, in_w + pad, border, value, padded);
+}
+
+#define INSTANTIATE_PAD(T) \
+    template void border_pad_row<T>(T *in_row, int32_t in_w, int32_t channels, int32_t pad, resize_border border, T value, T *padded);
+INSTANTIATE_PAD(uint8_t)
+INSTANTIATE_PAD(uint16_t)
+INSTANTIATE_PAD(float)
+
+double lanczos_kernel(double x, int32_t a) {
+    if (x == 0.0f) return 1.0f;
+    return a * sin(M_PI * x) * sin(M_PI * x / a) / pow(x, 2) / pow(M_PI, 2);
+}
+
+static double bilinear_kernel(double x, int32_t) {
+    return 1 - fabs(x);
+}
+
+// Keys cubic with B = 0, C = 1/2: interpolating, a negative lobe on 1..2
+static double catmull_rom_kernel(double x, int32_t) {
+    x = fabs(x);
+    if (x < 1) return (1.5 * x - 2.5) * x * x + 1;
+    return ((-0.5 * x + 2.5) * x - 4) * x + 2;
+}
+
+bool resize_filter_get(int32_t a, resize_filter *filter) {
+    resize_filter f;
+    switch (a) {
+    case FILTER_BILINEAR:
+        f = { "bilinear", filter_support(a), bilinear_kernel };
+        break;
+    case FILTER_BICUBIC:
+        f = { "bicubic", filter_support(a), catmull_rom_kernel };
+        break;
+    default:
+        if (!(a > 0)) return false;
+        f = { "lanczos", a, lanczos_kernel };
+        break;
+    }
+    if (filter) *filter = f;
+    return true;
+}
+
+static bool check_filter(int32_t a) {
+    if (resize_filter_get(a, NULL)) return true;
+    printf("a=%i should be greater than 0, FILTER_BILINEAR or FILTER_BICUBIC\n", a);
+    return false;
+}
+
+int32_t gcd(int32_t a, int32_t b) {
+    while (b) {
+        int32_t t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+lanczos_phases *lanczos_phases_build(int32_t in_size, int32_t out_size, int32_t a) {
+    resize_filter filter;
+    if (!resize_filter_get(a, &filter) || in_size <= 0 || out_size <= 0) {
+        printf("invalid phase bank: in=%i, out=%i, a=%i\n", in_size, out_size, a);
+        return NULL;
+    }
+
+    // out/in reduced to num_phases/step, e.g. 2x -> 2 phases advancing 1 input
+    int32_t g = gcd(in_size, out_size);
+    int32_t num_phases = out_size / g;
+    int32_t step = in_size / g;
+
+    // Downscaling stretches the kernel by in/out so every input sample under
+    // an output pixel contributes (a box-like low pass instead of point
+    // sampling 2a inputs), and centers output pixels on the inputs they
+    // cover. Upscaling keeps the 2a taps and the corner aligned grid of the
+    // AIE kernel. a is the support of the filter here, its half width
+    bool down = out_size < in_size;
+    int32_t support = filter.support;
+    int32_t half = down ? ((int64_t)support * step + num_phases - 1) / num_phases : support;
+    double scale = down ? (double)num_phases / step : 1.0;
+
+    lanczos_phases *phases = (lanczos_phases *)malloc(sizeof(lanczos_phases));
+    phases->in_size = in_size;
+    phases->out_size = out_size;
+    phases->a = a;
+    phases->taps = 2 * half;
+    phases->num_phases = num_phases;
+    phases->step = step;
+    phases->stride = align_taps(phases->taps);
+    phases->offset = (int32_t *)malloc(phases->num_phases * sizeof(int32_t));
+    phases->coeffs = (int16_t *)calloc(phases->num_phases * phases->stride, sizeof(int16_t));
+    phases->coeffs_f = (float *)calloc(phases->num_phases * phases->stride, sizeof(float));
+
+    double *k = (double *)malloc(phases->taps * sizeof(double));
+
+    for (int32_t p = 0; p < phases->num_phases; p++) {
+        int32_t in_p = (int64_t)p * step / num_phases;
+        double center = (double)p * step / num_phases;
+        if (down) {
+            in_p = ((int64_t)(2 * p + 1) * step - num_phases) / (2 * num_phases);
+            center = ((double)(2 * p + 1) * step - num_phases) / (2 * num_phases);
+        }
+        phases->offset[p] = in_p - half + 1;
+
+        double sum = 0;
+        for (int32_t t = 0; t < phases->taps; t++) {
+            double x = (phases->offset[p] + t - center) * scale;
+            k[t] = fabs(x) < support ? filter.kernel(x, a) : 0;
+            sum += k[t];
+        }
+
+        // round to fixed point and push the residue on the center tap
+        int16_t *w = phases->coeffs + p * phases->stride;
+        float *w_f = phases->coeffs_f + p * phases->stride;
+        int32_t int_sum = 0;
+        for (int32_t t = 0; t < phases->taps; t++) {
+            w[t] = lround(k[t] / sum * INT_SCALE);
+            w_f[t] = k[t] / sum;
+            int_sum += w[t];
+        }
+        w[half - 1] += INT_SCALE - int_sum;
+    }
+
+    free(k);
+    return phases;
+}
+
+void lanczos_phases_free(lanczos_phases *phases) {
+    if (!phases) return;
+    free(phases->offset);
+    free(phases->coeffs);
+    free(phases->coeffs_f);
+    free(phases);
+}
+
+// Banks are built once per geometry and kept for the lifetime of the
+// process: callers hold on to the pointers, lanczos() to two at a time and
+// streams for their whole life, other threads while they resize, so a bank
+// is never freed. A process only sees a handful of geometries, the list
+// just grows
+static lanczos_phases *phases_lookup(lanczos_phases **cache, int32_t count, int32_t in_size, int32_t out_size, int32_t a) {
+    for (int32_t i = 0; i < count; i++) {
+        lanczos_phases *p = cache[i];
+        if (p->in_size == in_size && p->out_size == out_size && p->a == a) {
+            return p;
+        }
+    }
+    return NULL;
+}
+
+lanczos_phases *lanczos_phases_cached(int32_t in_size, int32_t out_size, int32_t a) {
+    static lanczos_phases **cache = NULL;
+    static int32_t count = 0;
+    static int32_t capacity = 0;
+    static std::mutex mutex;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        lanczos_phases *found = phases_lookup(cache, count, in_size, out_size, a);
+        if (found) return found;
+    }
+
+    // built outside the lock, so threads resizing other geometries don't
+    // wait on it. If another thread added the same bank meanwhile, that one
+    // is returned and this one, never handed out, dropped
+    lanczos_phases *phases = lanczos_phases_build(in_size, out_size, a);
+    if (!phases) return NULL;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    lanczos_phases *found = phases_lookup(cache, count, in_size, out_size, a);
+    if (found) {
+        lanczos_phases_free(phases);
+        return found;
+    }
+    if (count == capacity) {
+        capacity = capacity ? 2 * capacity : 8;
+        cache = (lanczos_phases **)realloc(cache, capacity * sizeof(lanczos_phases *));
+    }
+    cache[count++] = phases;
+    return phases;
+}
+
+const resize_kernels kernels_scalar = {
+    horizontal_row_scalar<0, 0, 0>,
+    vertical_row_scalar<0>,
+    horizontal_row_interleaved_scalar
+};
+
+static const resize_kernels *isa_kernels[ISA_COUNT] = {
+    &kernels_scalar,
+    &kernels_sse41,
+    &kernels_avx2,
+    &kernels_avx512bw
+};
+
+static void nearest_row_scalar(uint8_t *in_row, uint8_t *out_row, nearest_columns *columns) {
+    nearest_pixels(in_row, out_row, columns, 0);
+}
+
+static const nearest_row_fn isa_nearest_rows[ISA_COUNT] = {
+    nearest_row_scalar,
+    nearest_row_sse41,
+    nearest_row_avx2,
+    nearest_row_avx512bw
+};
+
+const char *resize_isa_name(resize_isa isa) {
+    static const char *names[ISA_COUNT] = { "scalar", "sse4.1", "avx2", "avx512bw" };
+    return names[isa];
+}
+
+bool resize_isa_supported(resize_isa isa) {
+    __builtin_cpu_init();
+    switch (isa) {
+        case ISA_SCALAR:   return true;
+        case ISA_SSE41:    return __builtin_cpu_supports("sse4.1");
+        case ISA_AVX2:     return __builtin_cpu_supports("avx2");
+        case ISA_AVX512BW: return __builtin_cpu_supports("avx512bw");
+        default:           return false;
+    }
+}
+
+static resize_isa best_isa() {
+    for (int32_t isa = ISA_COUNT - 1; isa > ISA_SCALAR; isa--) {
+        if (resize_isa_supported((resize_isa)isa)) return (resize_isa)isa;
+    }
+    return ISA_SCALAR;
+}
+
+static resize_isa active_isa = best_isa();
+
+resize_isa resize_get_isa() {
+    return active_isa;
+}
+
+bool resize_set_isa(resize_isa isa) {
+    if (!resize_isa_supported(isa)) return false;
+    active_isa = isa;
+    return true;
+}
+
+const resize_kernels *resize_kernels_active() {
+    return isa_kernels[active_isa];
+}
+
+// vpermb isn't part of AVX-512BW: VBMI hosts get their own nearest kernel
+nearest_row_fn nearest_row_active() {
+    if (active_isa == ISA_AVX512BW && __builtin_cpu_supports("avx512vbmi")) return nearest_row_avx512vbmi;
+    return isa_nearest_rows[active_isa];
+}
+
+// a quarter of the L2 for the intermediate rows leaves room for the input
+// span and output rows of the tile
+static resize_tile default_tile() {
+    int64_t l2 = resize_get_caches().l2;
+    resize_tile tile = { (l2 ? l2 : DEFAULT_L2) / 4, DEFAULT_TILE_ROWS };
+    return tile;
+}
+
+static resize_tile active_tile = default_tile();
+
+resize_tile resize_get_tile() {
+    return active_tile;
+}
+
+void resize_set_tile(resize_tile tile) {
+    active_tile = tile;
+}
+
+// row y of an image of stride bytes
+template <typename T>
+static inline T *image_row(T *pixels, int32_t y, int32_t stride) {
+    return (T *)((uint8_t *)pixels + (int64_t)y * stride);
+}
+
+// I: the intermediate rows of T, see pixel_traits
+template <typename T, typename I = typename pixel_traits<T>::inter>
+struct lanczos_job {
+    T *in;
+    int32_t in_w;
+    int32_t in_h;
+    int32_t in_stride;  // bytes between rows
+    T *out;
+    int32_t out_w;
+    int32_t out_h;
+    int32_t out_stride;
+    int32_t channels;   // interleaved, 1 = grayscale
+    lanczos_phases *phases_x;
+    lanczos_phases *phases_y;
+    const typename pixel_traits<T>::kernels *kernels;
+    resize_border border;
+    T border_value;
+    int32_t pad;        // border_pad() columns each side, 0 for BORDER_CLAMP
+    T *padded;          // (in_w + 2 * pad) * channels per worker
+    T *constant;        // padded row of border_value, for BORDER_CONSTANT
+    int32_t strip_rows;
+    int32_t tile_w;     // output columns per tile, a multiple of num_phases
+    int32_t tiles_x;    // tiles per strip, 1 = untiled
+    int32_t span_w;     // input columns a tile reads, when tiled
+    T *spans;           // span_w * channels per worker, when tiled
+    I *rings;           // taps x tile_w * channels per worker
+    I **rows;           // taps per worker
+};
+
+// Separable: 2a taps per pass instead of a (2a)^2 stencil. The horizontal
+// pass output is kept in a ring of taps rows, indexed by input row, so every
+// input row of the strip is filtered once and the output is written
+// row-major. Each strip starts with an empty ring, i.e. it recomputes the
+// halo rows it shares with the strip above. With interleaved channels the
+// vertical pass doesn't care: a row is just out_w * channels samples.
+//
+// Tiled, a task is one tile of the strip: the columns [x0, x0 + tile_w) of
+// the output, so that the ring fits in cache. Tiles start on a phase period,
+// where the bank repeats shifted by in_x0 input columns, so the kernels
+// filter the tile as a row of its own: the input span it reads, seen at
+// in_x0 as padding plus row. Only spans past the image edges are copied,
+// with the border applied
+template <typename T, typename I = typename pixel_traits<T>::inter>
+static void lanczos_strip(int32_t task, int32_t worker, void *ctx) {
+    lanczos_job<T> *job = (lanczos_job<T> *)ctx;
+    lanczos_phases *phases_x = job->phases_x;
+    lanczos_phases *phases_y = job->phases_y;
+    int32_t taps = phases_y->taps;
+    int32_t channels = job->channels;
+    int32_t ring_w = job->tile_w * channels;
+
+    I *ring = job->rings + (int64_t)worker * taps * ring_w;
+    I **rows = job->rows + worker * taps;
+
+    int32_t strip = task / job->tiles_x;
+    int32_t x0 = task % job->tiles_x * job->tile_w;
+    int32_t tile_w = x0 + job->tile_w < job->out_w ? job->tile_w : job->out_w - x0;
+    int32_t out_w = tile_w * channels;
+
+    // span [in_x0 + span0, in_x0 + span1) of the input around the tile
+    int32_t in_x0 = x0 / phases_x->num_phases * phases_x->step;
+    int32_t span0 = phase_start(phases_x, 0) < 0 ? phase_start(phases_x, 0) : 0;
+    int32_t span1 = phase_start(phases_x, tile_w - 1) + load_width(phases_x);
+    T *span = job->spans + (int64_t)worker * job->span_w * channels;
+
+    int32_t y0 = strip * job->strip_rows;
+    int32_t y1 = y0 + job->strip_rows < job->out_h ? y0 + job->strip_rows : job->out_h;
+
+    int32_t base = y0 / phases_y->num_phases * phases_y->step;
+    int32_t p = y0 % phases_y->num_phases;
+    int32_t next_row = INT32_MIN;  // first input row not yet in the ring
+    for (int32_t y = y0; y < y1; y++) {
+        int32_t start = base + phases_y->offset[p];
+
+        if (next_row < start) next_row = start;
+        for (; next_row < start + taps; next_row++) {
+            int32_t in_y = border_index(next_row, job->in_h, job->border);
+            I *slot = ring + ((next_row % taps + taps) % taps) * ring_w;
+            T *in_row = image_row(job->in, in_y, job->in_stride);
+
+            if (job->tiles_x > 1) {
+                T *tile_row = in_row + in_x0 * channels;
+                if (in_y < 0) {
+                    for (int32_t i = 0; i < (span1 - span0) * channels; i++) {
+                        span[i] = job->border_value;
+                    }
+                    tile_row = span - span0 * channels;
+                } else if (in_x0 + span0 < 0 || in_x0 + span1 > job->in_w) {
+                    border_span(in_row, job->in_w, channels, in_x0 + span0, in_x0 + span1, job->border, job->border_value, span);
+                    tile_row = span - span0 * channels;
+                }
+
+                if (channels == 1) {
+                    job->kernels->horizontal_row(tile_row, span1 + span0, -span0, slot, tile_w, phases_x);
+                } else {
+                    job->kernels->horizontal_row_interleaved(tile_row, span1 + span0, -span0, channels, slot, tile_w, phases_x);
+                }
+                continue;
+            }
+
+            // other modes than clamp filter a padded copy of the row, so the
+            // kernels never see the edges
+            if (job->border != BORDER_CLAMP && in_y < 0) {
+                in_row = job->constant + job->pad * channels;
+            } else if (job->border != BORDER_CLAMP) {
+                T *padded = job->padded + (int64_t)worker * (job->in_w + 2 * job->pad) * channels;
+                border_pad_row(in_row, job->in_w, channels, job->pad, job->border, job->border_value, padded);
+                in_row = padded + job->pad * channels;
+            }
+
+            if (channels == 1) {
+                job->kernels->horizontal_row(in_row, job->in_w, job->pad, slot, job->out_w, job->phases_x);
+            } else {
+                job->kernels->horizontal_row_interleaved(in_row, job->in_w, job->pad, channels, slot, job->out_w, job->phases_x);
+            }
+        }
+
+        for (int32_t t = 0; t < taps; t++) {
+            rows[t] = ring + (((start + t) % taps + taps) % taps) * ring_w;
+        }
+        I *w = pixel_traits<T>::coeffs(phases_y) + p * phases_y->stride;
+        job->kernels->vertical_row(rows, w, taps, image_row(job->out, y, job->out_stride) + x0 * channels, out_w);
+
+        if (++p == phases_y->num_phases) {
+            p = 0;
+            base += phases_y->step;
+        }
+    }
+}
+
+// Scratch rows of lanczos_run(), per calling thread: grown on demand and
+// kept, so resizing frame after frame doesn't allocate. Untyped, any pixel
+// type reuses the same buffers; sizes are in bytes
+struct lanczos_scratch {
+    void *rings = NULL;
+    int64_t rings_size = 0;
+    void *rows = NULL;
+    int64_t rows_size = 0;
+    void *padded = NULL;
+    int64_t padded_size = 0;
+
+    ~lanczos_scratch() {
+        free(rings);
+        free(rows);
+        free(padded);
+    }
+};
+
+static thread_local lanczos_scratch scratch;
+
+static void *scratch_grow(void *buf, int64_t *size, int64_t needed) {
+    if (needed <= *size) return buf;
+    free(buf);
+    *size = needed;
+    return malloc(needed);
+}
+
+// Fills in job and sizes the scratch rows for images resized with it, one
+// at a time or as a batch. Returns the number of tasks (strips, or tiles
+// of strips) per image
+template <typename T, typename I = typename pixel_traits<T>::inter>
+static int32_t lanczos_setup(
+    lanczos_job<T> &job,
+    T *in, int32_t in_w, int32_t in_h, int32_t in_stride, int32_t channels,
+    T *out, int32_t out_w, int32_t out_h, int32_t out_stride,
+    lanczos_phases *phases_x, lanczos_phases *phases_y,
+    const typename pixel_traits<T>::kernels *kernels,
+    resize_border border, T border_value,
+    int32_t threads, int32_t images
+) {
+    // nothing to write, e.g. 2 columns at 3/7, and no last output column to
+    // size the spans and the padding by
+    if (out_w < 1 || out_h < 1) return 0;
+
+    job.in = in;
+    job.in_w = in_w;
+    job.in_h = in_h;
+    job.in_stride = in_stride;
+    job.out = out;
+    job.out_w = out_w;
+    job.out_h = out_h;
+    job.out_stride = out_stride;
+    job.channels = channels;
+    job.phases_x = phases_x;
+    job.phases_y = phases_y;
+    job.kernels = kernels;
+    job.border = border;
+    job.border_value = border_value;
+    job.pad = border == BORDER_CLAMP ? 0 : border_pad(phases_x, in_w, out_w);
+    job.strip_rows = strip_rows(out_h, threads, images);
+    job.tile_w = out_w;
+    job.tiles_x = 1;
+
+    // tiled when the ring of a strip wouldn't fit the tile budget
+    resize_tile tile = resize_get_tile();
+    int64_t column_bytes = (int64_t)phases_y->taps * channels * sizeof(I);
+    int32_t num_phases = phases_x->num_phases;
+    int64_t tile_w = tile.bytes / column_bytes / num_phases * num_phases;
+    if (tile.bytes > 0 && column_bytes * out_w > tile.bytes) {
+        job.tile_w = tile_w > num_phases ? (tile_w < out_w ? tile_w : out_w) : num_phases;
+        job.tiles_x = (out_w + job.tile_w - 1) / job.tile_w;
+        job.strip_rows = tile.rows > 0 ? tile.rows : DEFAULT_TILE_ROWS;
+    }
+
+    int32_t num_strips = (out_h + job.strip_rows - 1) / job.strip_rows;
+    int32_t participants = thread_pool_participants(threads);
+
+    int64_t rings_size = (int64_t)participants * phases_y->taps * job.tile_w * channels * sizeof(I);
+    scratch.rings = scratch_grow(scratch.rings, &scratch.rings_size, rings_size);
+    int64_t rows_size = (int64_t)participants * phases_y->taps * sizeof(I *);
+    scratch.rows = scratch_grow(scratch.rows, &scratch.rows_size, rows_size);
+    job.rings = (I *)scratch.rings;
+    job.rows = (I **)scratch.rows;
+
+    // a span per worker, or a padded row per worker then the constant one
+    if (job.tiles_x > 1) {
+        int32_t span0 = phase_start(phases_x, 0) < 0 ? phase_start(phases_x, 0) : 0;
+        job.span_w = phase_start(phases_x, job.tile_w - 1) + load_width(phases_x) - span0;
+        scratch.padded = scratch_grow(scratch.padded, &scratch.padded_size, (int64_t)participants * job.span_w * channels * sizeof(T));
+        job.spans = (T *)scratch.padded;
+    } else if (border != BORDER_CLAMP) {
+        int64_t padded_w = (int64_t)(in_w + 2 * job.pad) * channels;
+        scratch.padded = scratch_grow(scratch.padded, &scratch.padded_size, (participants + 1) * padded_w * sizeof(T));
+        job.padded = (T *)scratch.padded;
+        job.constant = job.padded + participants * padded_w;
+        for (int64_t i = 0; i < padded_w; i++) {
+            job.constant[i] = border_value;
+        }
+    }
+
+    return num_strips * job.tiles_x;
+}
+
+template <typename T>
+static void lanczos_run(
+    T *in, int32_t in_w, int32_t in_h, int32_t in_stride, int32_t channels,
+    T *out, int32_t out_w, int32_t out_h, int32_t out_stride,
+    lanczos_phases *phases_x, lanczos_phases *phases_y,
+    const typename pixel_traits<T>::kernels *kernels,
+    resize_border border, T border_value,
+    int32_t threads
+) {
+    lanczos_job<T> job;
+    int32_t num_strips = lanczos_setup(
+        job, in, in_w, in_h, in_stride, channels, out, out_w, out_h, out_stride,
+        phases_x, phases_y, kernels, border, border_value, threads, 1
+    );
+    thread_pool_run(num_strips, threads, lanczos_strip<T>, &job);
+}
+
+// one task per strip of every image of the batch
+struct lanczos_batch_job {
+    lanczos_job<uint8_t> job;
+    uint8_t **in;
+    uint8_t **out;
+    int32_t num_strips;     // per image
+};
+
+static void lanczos_batch_strip(int32_t task, int32_t worker, void *ctx) {
+    lanczos_batch_job *batch = (lanczos_batch_job *)ctx;
+    lanczos_job<uint8_t> job = batch->job;
+    job.in = batch->in[task / batch->num_strips];
+    job.out = batch->out[task / batch->num_strips];
+    lanczos_strip<uint8_t>(task % batch->num_strips, worker, &job);
+}
+
+// constexpr sin for the compile-time phase tables: reduced to [-pi/2, pi/2]
+// so the Taylor series is accurate to the last bit of a double
+static constexpr double ce_sin(double x) {
+    int64_t k = x / (2 * M_PI);
+    x -= k * (2 * M_PI);
+    if (x > M_PI) x -= 2 * M_PI;
+    if (x < -M_PI) x += 2 * M_PI;
+    if (x > M_PI / 2) x = M_PI - x;
+    if (x < -M_PI / 2) x = -M_PI - x;
+
+    double term = x;
+    double sum = x;
+    for (int32_t i = 1; i < 20; i++) {
+        term *= -x * x / ((2 * i) * (2 * i + 1));
+        sum += term;
+    }
+    return sum;
+}
+
+static constexpr double ce_lanczos_kernel(double x, int32_t a) {
+    if (x == 0.0f) return 1.0f;
+    return a * ce_sin(M_PI * x) * ce_sin(M_PI * x / a) / (x * x) / (M_PI * M_PI);
+}
+
+// the kernels of resize_filter_get(), for the compiler
+static constexpr double ce_filter_kernel(double x, int32_t a) {
+    double ax = x < 0 ? -x : x;
+    if (a == FILTER_BILINEAR) return ax < 1 ? 1 - ax : 0;
+    if (a == FILTER_BICUBIC) {
+        if (ax < 1) return (1.5 * ax - 2.5) * ax * ax + 1;
+        return ax < 2 ? ((-0.5 * ax + 2.5) * ax - 4) * ax + 2 : 0;
+    }
+    return ce_lanczos_kernel(x, a);
+}
+
+template <int32_t A, int32_t NUM, int32_t DEN>
+struct lanczos_spec_tables {
+    int32_t offset[NUM];
+    int16_t coeffs[NUM * align_taps(2 * filter_support(A))];
+};
+
+// same construction as lanczos_phases_build(), evaluated by the compiler
+template <int32_t A, int32_t NUM, int32_t DEN>
+static constexpr lanczos_spec_tables<A, NUM, DEN> lanczos_spec_build() {
+    constexpr int32_t half = filter_support(A);
+    constexpr int32_t taps = 2 * half;
+    constexpr int32_t stride = align_taps(taps);
+    lanczos_spec_tables<A, NUM, DEN> tables = {};
+
+    for (int32_t p = 0; p < NUM; p++) {
+        int32_t in_p = p * DEN / NUM;
+        double center = (double)p * DEN / NUM;
+        tables.offset[p] = in_p - half + 1;
+
+        double k[taps] = {};
+        double sum = 0;
+        for (int32_t t = 0; t < taps; t++) {
+            k[t] = ce_filter_kernel(tables.offset[p] + t - center, A);
+            sum += k[t];
+        }
+
+        int16_t *w = tables.coeffs + p * stride;
+        int32_t int_sum = 0;
+        for (int32_t t = 0; t < taps; t++) {
+            double v = k[t] / sum * INT_SCALE;
+            w[t] = v < 0 ? (int16_t)(v - 0.5) : (int16_t)(v + 0.5);
+            int_sum += w[t];
+        }
+        w[half - 1] += INT_SCALE - int_sum;
+    }
+
+    return tables;
+}
+
+template <int32_t A, int32_t NUM, int32_t DEN>
+static lanczos_phases *lanczos_phases_spec() {
+    static constexpr lanczos_spec_tables<A, NUM, DEN> ce_tables = lanczos_spec_build<A, NUM, DEN>();
+    static lanczos_spec_tables<A, NUM, DEN> tables = ce_tables;
+    static lanczos_phases phases = {
+        0, 0, A, 2 * filter_support(A), NUM, DEN, align_taps(2 * filter_support(A)), tables.offset, tables.coeffs, NULL
+    };
+    return &phases;
+}
+
+template <int32_t A, int32_t NUM, int32_t DEN>
+uint8_t *lanczos_resize(uint8_t *in, int32_t in_w, int32_t in_h, int32_t threads) {
+    if (in_w * NUM % DEN || in_h * NUM % DEN) {
+        printf("%ix%i can't be scaled by exactly %i/%i\n", in_w, in_h, NUM, DEN);
+        return NULL;
+    }
+
+    int32_t out_w = in_w * NUM / DEN;
+    int32_t out_h = in_h * NUM / DEN;
+    uint8_t *out = (uint8_t *)malloc((int64_t)out_w * out_h * sizeof(uint8_t));
+
+    lanczos_phases *phases = lanczos_phases_spec<A, NUM, DEN>();
+    const resize_kernels *kernels = resize_kernels_spec<A, NUM, DEN>(resize_get_isa());
+    lanczos_run<uint8_t>(in, in_w, in_h, in_w, 1, out, out_w, out_h, out_w, phases, phases, kernels, BORDER_CLAMP, 0, threads);
+    return out;
+}
+
+#define INSTANTIATE_SPEC(a, num, den) \
+    template uint8_t *lanczos_resize<a, num, den>(uint8_t *in, int32_t in_w, int32_t in_h, int32_t threads);
+LANCZOS_SPECS(INSTANTIATE_SPEC)
+
+bool lanczos_bank(int32_t p, int32_t q, int32_t a, lanczos_phases **phases, const resize_kernels **kernels) {
+    // the specialized kernels only depend on the bank, any image size works
+#define LOOKUP_SPEC(sa, snum, sden) \
+    if (a == sa && p == snum && q == sden) { \
+        *phases = lanczos_phases_spec<sa, snum, sden>(); \
+        *kernels = resize_kernels_spec<sa, snum, sden>(resize_get_isa()); \
+        return true; \
+    }
+    LANCZOS_SPECS(LOOKUP_SPEC)
+#undef LOOKUP_SPEC
+
+    *phases = lanczos_phases_cached(q, p, a);
+    *kernels = resize_kernels_active();
+    return *phases != NULL;
+}
+
+bool resize_plane(
+    uint8_t *in, int32_t in_w, int32_t in_h, int32_t in_stride, int32_t channels,
+    uint8_t *out, int32_t out_w, int32_t out_h, int32_t out_stride,
+    int32_t p, int32_t q, int32_t a,
+    resize_border border, uint8_t border_value,
+    int32_t threads
+) {
+    if (a == 0) {
+        nearest_run(in, in_w, in_h, in_stride, channels, out, out_w, out_h, out_stride, threads);
+        return true;
+    }
+
+    lanczos_phases *phases;
+    const resize_kernels *kernels;
+    if (!lanczos_bank(p, q, a, &phases, &kernels)) return false;
+
+    lanczos_run<uint8_t>(in, in_w, in_h, in_stride, channels, out, out_w, out_h, out_stride, phases, phases, kernels, border, border_value, threads);
+    return true;
+}
+
+uint8_t *lanczos(
+    uint8_t *in,
+    int32_t in_w,
+    int32_t in_h,
+    double scale_factor,
+    int32_t a,
+    int32_t threads
+) {
+    if (!check_filter(a)) return NULL;
+
+    int32_t out_w = in_w * scale_factor;
+    int32_t out_h = in_h * scale_factor;
+
+    // same reduced out/in ratio on both axes -> one bank, maybe specialized
+    int32_t g = gcd(in_w, out_w);
+    int32_t num = out_w / g;
+    int32_t den = in_w / g;
+    if ((int64_t)in_h * num == (int64_t)out_h * den) {
+        return lanczos_interleaved(in, in_w, in_h, 1, num, den, a, threads);
+    }
+
+    lanczos_phases *phases_x = lanczos_phases_cached(in_w, out_w, a);
+    lanczos_phases *phases_y = lanczos_phases_cached(in_h, out_h, a);
+    if (!phases_x || !phases_y) return NULL;
+
+    uint8_t *out = (uint8_t *)malloc((int64_t)out_w * out_h * sizeof(uint8_t));
+    lanczos_run<uint8_t>(in, in_w, in_h, in_w, 1, out, out_w, out_h, out_w, phases_x, phases_y, resize_kernels_active(), BORDER_CLAMP, 0, threads);
+    return out;
+}
+
+uint8_t *lanczos_rational(
+    uint8_t *in,
+    int32_t in_w,
+    int32_t in_h,
+    int32_t num,
+    int32_t den,
+    int32_t a,
+    int32_t threads
+) {
+    return lanczos_interleaved(in, in_w, in_h, 1, num, den, a, threads);
+}
+
+// uint16 / float planes: the runtime bank, whose float weights the compile
+// time ones don't have, and the float kernels. a is a filter, checked by
+// the caller
+template <typename T>
+static bool resize_plane_float(
+    T *in, int32_t in_w, int32_t in_h, int32_t in_stride, int32_t channels,
+    T *out, int32_t out_w, int32_t out_h, int32_t out_stride,
+    int32_t p, int32_t q, int32_t a,
+    resize_border border, T border_value,
+    int32_t threads
+) {
+    lanczos_phases *phases = lanczos_phases_cached(q, p, a);
+    if (!phases) return false;
+
+    lanczos_run<T>(in, in_w, in_h, in_stride, channels, out, out_w, out_h, out_stride, phases, phases, resize_kernels_float_isa<T>(resize_get_isa()), border, border_value, threads);
+    return true;
+}
+
+static bool resize_plane_typed(
+    uint8_t *in, int32_t in_w, int32_t in_h, int32_t in_stride, int32_t channels,
+    uint8_t *out, int32_t out_w, int32_t out_h, int32_t out_stride,
+    int32_t p, int32_t q, int32_t a,
+    resize_border border, uint8_t border_value,
+    int32_t threads
+) {
+    return resize_plane(in, in_w, in_h, in_stride, channels, out, out_w, out_h, out_stride, p, q, a, border, border_value, threads);
+}
+
+static bool resize_plane_typed(
+    uint16_t *in, int32_t in_w, int32_t in_h, int32_t in_stride, int32_t channels,
+    uint16_t *out, int32_t out_w, int32_t out_h, int32_t out_stride,
+    int32_t p, int32_t q, int32_t a,
+    resize_border border, uint16_t border_value,
+    int32_t threads
+) {
+    return resize_plane_float(in, in_w, in_h, in_stride, channels, out, out_w, out_h, out_stride, p, q, a, border, border_value, threads);
+}
+
+static bool resize_plane_typed(
+    float *in, int32_t in_w, int32_t in_h, int32_t in_stride, int32_t channels,
+    float *out, int32_t out_w, int32_t out_h, int32_t out_stride,
+    int32_t p, int32_t q, int32_t a,
+    resize_border border, float border_value,
+    int32_t threads
+) {
+    return resize_plane_float(in, in_w, in_h, in_stride, channels, out, out_w, out_h, out_stride, p, q, a, border, border_value, threads);
+}
+
+// Checks the parameters of lanczos_into() and friends, and reduces the
+// scale to p/q in lowest terms with the output size. pixel is in bytes
+static bool lanczos_geometry(
+    int32_t in_w, int32_t in_h, int32_t in_stride, int32_t out_stride, int32_t pixel,
+    int32_t channels, int32_t num, int32_t den, int32_t a,
+    int32_t *p, int32_t *q, int32_t *out_w, int32_t *out_h
+) {
+    if (!check_filter(a)) return false;
+    if (num <= 0 || den <= 0) {
+        printf("invalid scale factor %i/%i\n", num, den);
+        return false;
+    }
+    if (channels < 1 || channels > 4) {
+        printf("unsupported channel count %i\n", channels);
+        return false;
+    }
+    if (in_w < 1 || in_h < 1) {
+        printf("invalid image size %ix%i\n", in_w, in_h);
+        return false;
+    }
+
+    // scale p/q in lowest terms on both axes: one bank of p phases, whatever
+    // the image size; when in * p isn't a multiple of q the last outputs
+    // just don't complete a period
+    int32_t g = gcd(num, den);
+    *p = num / g;
+    *q = den / g;
+    *out_w = (int64_t)in_w * *p / *q;
+    *out_h = (int64_t)in_h * *p / *q;
+
+    if (in_stride < in_w * pixel || out_stride < *out_w * pixel) {
+        printf("row stride %i/%i shorter than a row\n", in_stride, out_stride);
+        return false;
+    }
+    return true;
+}
+
+template <typename T>
+static bool lanczos_into_typed(
+    T *in, int32_t in_w, int32_t in_h, int32_t in_stride,
+    T *out, int32_t out_stride,
+    int32_t channels, int32_t num, int32_t den, int32_t a,
+    int32_t threads,
+    resize_border border,
+    T border_value
+) {
+    int32_t p, q, out_w, out_h;
+    if (!lanczos_geometry(in_w, in_h, in_stride, out_stride, channels * sizeof(T), channels, num, den, a, &p, &q, &out_w, &out_h)) {
+        return false;
+    }
+
+    return resize_plane_typed(in, in_w, in_h, in_stride, channels, out, out_w, out_h, out_stride, p, q, a, border, border_value, threads);
+}
+
+template <typename T>
+static T *lanczos_interleaved_typed(
+    T *in, int32_t in_w, int32_t in_h, int32_t channels,
+    int32_t num, int32_t den, int32_t a,
+    int32_t threads,
+    resize_border border,
+    T border_value
+) {
+    if (num <= 0 || den <= 0) {
+        printf("invalid scale factor %i/%i\n", num, den);
+        return NULL;
+    }
+
+    int32_t out_w = (int64_t)in_w * num / den;
+    int32_t out_h = (int64_t)in_h * num / den;
+    int32_t pixel = channels * sizeof(T);
+    T *out = (T *)malloc((int64_t)out_w * out_h * pixel);
+
+    if (!lanczos_into_typed(in, in_w, in_h, in_w * pixel, out, out_w * pixel, channels, num, den, a, threads, border, border_value)) {
+        free(out);
+        return NULL;
+    }
+    return out;
+}
+
+uint8_t *lanczos_interleaved(
+    uint8_t *in, int32_t in_w, int32_t in_h, int32_t channels,
+    int32_t num, int32_t den, int32_t a,
+    int32_t threads, resize_border border, uint8_t border_value
+) {
+    return lanczos_interleaved_typed(in, in_w, in_h, channels, num, den, a, threads, border, border_value);
+}
+
+uint16_t *lanczos_interleaved(
+    uint16_t *in, int32_t in_w, int32_t in_h, int32_t channels,
+    int32_t num, int32_t den, int32_t a,
+    int32_t threads, resize_border border, uint16_t border_value
+) {
+    return lanczos_interleaved_typed(in, in_w, in_h, channels, num, den, a, threads, border, border_value);
+}
+
+float *lanczos_interleaved(
+    float *in, int32_t in_w, int32_t in_h, int32_t channels,
+    int32_t num, int32_t den, int32_t a,
+    int32_t threads, resize_border border, float border_value
+) {
+    return lanczos_interleaved_typed(in, in_w, in_h, channels, num, den, a, threads, border, border_value);
+}
+
+bool lanczos_into(
+    uint8_t *in, int32_t in_w, int32_t in_h, int32_t in_stride,
+    uint8_t *out, int32_t out_stride,
+    int32_t channels, int32_t num, int32_t den, int32_t a,
+    int32_t threads, resize_border border, uint8_t border_value
+) {
+    return lanczos_into_typed(in, in_w, in_h, in_stride, out, out_stride, channels, num, den, a, threads, border, border_value);
+}
+
+bool lanczos_into(
+    uint16_t *in, int32_t in_w, int32_t in_h, int32_t in_stride,
+    uint16_t *out, int32_t out_stride,
+    int32_t channels, int32_t num, int32_t den, int32_t a,
+    int32_t threads, resize_border border, uint16_t border_value
+) {
+    return lanczos_into_typed(in, in_w, in_h, in_stride, out, out_stride, channels, num, den, a, threads, border, border_value);
+}
+
+bool lanczos_into(
+    float *in, int32_t in_w, int32_t in_h, int32_t in_stride,
+    float *out, int32_t out_stride,
+    int32_t channels, int32_t num, int32_t den, int32_t a,
+    int32_t threads, resize_border border, float border_value
+) {
+    return lanczos_into_typed(in, in_w, in_h, in_stride, out, out_stride, channels, num, den, a, threads, border, border_value);
+}
+
+bool nearest_into(
+    uint8_t *in, int32_t in_w, int32_t in_h, int32_t in_stride,
+    uint8_t *out, int32_t out_stride,
+    int32_t channels, int32_t num, int32_t den,
+    int32_t threads
+) {
+    // any a passes: nearest neighbor has no taps
+    int32_t p, q, out_w, out_h;
+    if (!lanczos_geometry(in_w, in_h, in_stride, out_stride, channels, channels, num, den, 1, &p, &q, &out_w, &out_h)) {
+        return false;
+    }
+
+    nearest_run(in, in_w, in_h, in_stride, channels, out, out_w, out_h, out_stride, threads);
+    return true;
+}
+
+bool lanczos_batch(
+    uint8_t **in, int32_t in_w, int32_t in_h, int32_t in_stride,
+    uint8_t **out, int32_t out_stride,
+    int32_t count, int32_t channels, int32_t num, int32_t den, int32_t a,
+    int32_t threads,
+    resize_border border,
+    uint8_t border_value
+) {
+    int32_t p, q, out_w, out_h;
+    if (!lanczos_geometry(in_w, in_h, in_stride, out_stride, channels, channels, num, den, a, &p, &q, &out_w, &out_h)) {
+        return false;
+    }
+    if (count <= 0) return count == 0;
+
+    lanczos_phases *phases;
+    const resize_kernels *kernels;
+    if (!lanczos_bank(p, q, a, &phases, &kernels)) return false;
+
+    lanczos_batch_job batch;
+    batch.in = in;
+    batch.out = out;
+    batch.num_strips = lanczos_setup<uint8_t>(
+        batch.job, in[0], in_w, in_h, in_stride, channels, out[0], out_w, out_h, out_stride,
+        phases, phases, kernels, border, border_value, threads, count
+    );
+    thread_pool_run(count * batch.num_strips, threads, lanczos_batch_strip, &batch);
+    return true;
+}
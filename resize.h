@@ -0,0 +1,238 @@
+#pragma once
+
+#include <stdint.h>
+
+#define INT_SCALE_BITS 12
+#define INT_SCALE (1 << INT_SCALE_BITS)
+
+// fixed point precision of the intermediate rows (between the two passes)
+#define INTER_BITS 6
+
+// Polyphase coefficient bank for one axis. Output i reads taps input samples
+// starting at (i / num_phases) * step + offset[i % num_phases], weighted by
+// coeffs[(i % num_phases) * stride ...], each phase summing to INT_SCALE,
+// or coeffs_f summing to 1 for the float pipeline of uint16 / float pixels.
+// taps is 2a when upscaling and 2 * ceil(a * in / out) when downscaling,
+// where the kernel is stretched to low pass the input
+struct lanczos_phases {
+    int32_t in_size;
+    int32_t out_size;
+    int32_t a;
+    int32_t taps;
+    int32_t num_phases;
+    int32_t step;
+    int32_t stride;     // taps rounded up to TAPS_ALIGN, padded with zeros
+    int32_t *offset;    // num_phases
+    int16_t *coeffs;    // num_phases x stride
+    float *coeffs_f;    // num_phases x stride, NULL in the compile-time banks
+};
+
+// instruction sets the row kernels are built for, picked at startup via cpuid
+enum resize_isa {
+    ISA_SCALAR,
+    ISA_SSE41,
+    ISA_AVX2,
+    ISA_AVX512BW,
+    ISA_COUNT
+};
+
+// what the filters see past the image edges, for a row "abcd" of value v
+enum resize_border {
+    BORDER_CLAMP,       // aaa|abcd|ddd, edge pixel repeated
+    BORDER_MIRROR,      // dcb|abcd|cba, reflected around the edge pixel like c_test
+    BORDER_WRAP,        // bcd|abcd|abc, tiled
+    BORDER_CONSTANT     // vvv|abcd|vvv
+};
+
+// Cache blocking of large images: when the taps intermediate rows of a
+// strip would take more than bytes, the output is cut into tiles of rows
+// output rows by as many columns as fit, each running both passes while
+// its intermediate rows stay in cache. bytes <= 0 never tiles
+struct resize_tile {
+    int64_t bytes;
+    int32_t rows;
+};
+
+// data cache sizes in bytes, 0 where sysfs doesn't tell
+struct resize_caches {
+    int64_t l1;
+    int64_t l2;
+    int64_t l3;
+};
+
+// assumed when the L2 size is unknown
+#define DEFAULT_L2 (256 * 1024)
+#define DEFAULT_TILE_ROWS 64
+
+// where resize_autotune() keeps the tuned tile shape
+#define RESIZE_PROFILE "resize_tile.profile"
+
+// Filters of the phase banks. Wherever an a is taken, a > 0 is Lanczos of
+// that a and these the cheaper fixed kernels, in the same separable engine
+// (SIMD kernels, threads, tiles, streams): 2 and 4 taps when upscaling,
+// stretched like Lanczos when downscaling
+#define FILTER_BILINEAR (-1)
+#define FILTER_BICUBIC (-2)     // Catmull-Rom
+
+struct resize_filter {
+    const char *name;
+    int32_t support;    // kernel(x) is 0 for |x| >= support, 2 * support taps
+    double (*kernel)(double x, int32_t a);
+};
+
+int32_t clamp(int32_t in, int32_t low, int32_t high);
+double lanczos_kernel(double x, int32_t a);
+// the filter a stands for, false if none (filter may be NULL to check a)
+bool resize_filter_get(int32_t a, resize_filter *filter);
+int32_t gcd(int32_t a, int32_t b);
+
+lanczos_phases *lanczos_phases_build(int32_t in_size, int32_t out_size, int32_t a);
+void lanczos_phases_free(lanczos_phases *phases);
+// The bank of the geometry, built on first use. Thread safe, and the bank
+// stays valid for the life of the process: cached banks are never freed
+lanczos_phases *lanczos_phases_cached(int32_t in_size, int32_t out_size, int32_t a);
+
+const char *resize_isa_name(resize_isa isa);
+bool resize_isa_supported(resize_isa isa);
+resize_isa resize_get_isa();
+// overrides the startup choice (e.g. to compare variants), false if the host
+// can't run the requested kernels
+bool resize_set_isa(resize_isa isa);
+
+resize_caches resize_get_caches();
+// the tile shape of every resize, by default a quarter of the L2 for the
+// intermediate rows and DEFAULT_TILE_ROWS rows
+resize_tile resize_get_tile();
+void resize_set_tile(resize_tile tile);
+// Sets the tile shape stored in profile for the host's caches. Without one,
+// times candidate shapes sized from the caches on a synthetic image wider
+// than the L2 can block untiled (about a second) and stores the fastest
+resize_tile resize_autotune(const char *profile = RESIZE_PROFILE);
+
+// threads: number of threads to split the output rows across, 0 = all cores
+void neareast_neightbor(
+    uint8_t *in_pixels, uint32_t in_w, uint32_t in_h,
+    uint8_t *out_pixels, uint32_t out_w, uint32_t out_h,
+    int32_t threads = 0
+);
+
+uint8_t *lanczos(
+    uint8_t *in,
+    int32_t in_w,
+    int32_t in_h,
+    double scale_factor,
+    int32_t a,
+    int32_t threads = 0
+);
+
+// scale factor num/den (e.g. 3/2 for 720p -> 1080p), exact where a double
+// isn't: out = in * num / den, rounded down
+uint8_t *lanczos_rational(
+    uint8_t *in,
+    int32_t in_w,
+    int32_t in_h,
+    int32_t num,
+    int32_t den,
+    int32_t a,
+    int32_t threads = 0
+);
+
+// interleaved pixels of 1 to 4 channels (gray, gray + alpha, RGB, RGBA),
+// all channels filtered in the same pass, out = in * num / den. Past the
+// edges the filters see border, border_value for BORDER_CONSTANT
+uint8_t *lanczos_interleaved(
+    uint8_t *in,
+    int32_t in_w,
+    int32_t in_h,
+    int32_t channels,
+    int32_t num,
+    int32_t den,
+    int32_t a,
+    int32_t threads = 0,
+    resize_border border = BORDER_CLAMP,
+    uint8_t border_value = 0
+);
+
+// lanczos_interleaved() into a caller buffer of out_w x out_h = in * num /
+// den pixels. Row y of the input starts at in + y * in_stride bytes, of the
+// output at out + y * out_stride. Doesn't allocate once the phase bank and
+// the calling thread's scratch rows are warm, i.e. after the first call with
+// a given size. Returns false if the parameters are invalid
+bool lanczos_into(
+    uint8_t *in, int32_t in_w, int32_t in_h, int32_t in_stride,
+    uint8_t *out, int32_t out_stride,
+    int32_t channels, int32_t num, int32_t den, int32_t a,
+    int32_t threads = 0,
+    resize_border border = BORDER_CLAMP,
+    uint8_t border_value = 0
+);
+
+// Nearest neighbor of interleaved pixels (1 to 4 channels) into a caller
+// buffer of in * num / den pixels, strides as for lanczos_into(). Source
+// columns come from an integer table cached per geometry, integer upscales
+// shuffle 16 bytes at a time with the SIMD kernels, and output rows
+// repeating an input row are copied from the row above. Doesn't allocate
+// after the first call with a given geometry. Returns false if the
+// parameters are invalid
+bool nearest_into(
+    uint8_t *in, int32_t in_w, int32_t in_h, int32_t in_stride,
+    uint8_t *out, int32_t out_stride,
+    int32_t channels, int32_t num, int32_t den,
+    int32_t threads = 0
+);
+
+// uint16 (HDR, medical) and float pixels, same filters and borders as the
+// uint8 versions but accumulated in float, so nothing is quantized to 8
+// bits. Strides are still in bytes. uint16 outputs are rounded and saturated
+// to 0..65535, float outputs keep the ringing past the input range
+uint16_t *lanczos_interleaved(
+    uint16_t *in, int32_t in_w, int32_t in_h, int32_t channels,
+    int32_t num, int32_t den, int32_t a,
+    int32_t threads = 0,
+    resize_border border = BORDER_CLAMP,
+    uint16_t border_value = 0
+);
+float *lanczos_interleaved(
+    float *in, int32_t in_w, int32_t in_h, int32_t channels,
+    int32_t num, int32_t den, int32_t a,
+    int32_t threads = 0,
+    resize_border border = BORDER_CLAMP,
+    float border_value = 0
+);
+bool lanczos_into(
+    uint16_t *in, int32_t in_w, int32_t in_h, int32_t in_stride,
+    uint16_t *out, int32_t out_stride,
+    int32_t channels, int32_t num, int32_t den, int32_t a,
+    int32_t threads = 0,
+    resize_border border = BORDER_CLAMP,
+    uint16_t border_value = 0
+);
+bool lanczos_into(
+    float *in, int32_t in_w, int32_t in_h, int32_t in_stride,
+    float *out, int32_t out_stride,
+    int32_t channels, int32_t num, int32_t den, int32_t a,
+    int32_t threads = 0,
+    resize_border border = BORDER_CLAMP,
+    float border_value = 0
+);
+
+// count images of one geometry (e.g. thumbnails) resized as lanczos_into()
+// with the same strides: the bank, kernels and scratch rows are set up once
+// for the batch and a single pool run covers every strip of every image, so
+// the threads work across images as well as within them
+bool lanczos_batch(
+    uint8_t **in, int32_t in_w, int32_t in_h, int32_t in_stride,
+    uint8_t **out, int32_t out_stride,
+    int32_t count, int32_t channels, int32_t num, int32_t den, int32_t a,
+    int32_t threads = 0,
+    resize_border border = BORDER_CLAMP,
+    uint8_t border_value = 0
+);
+
+// lanczos() with a and the scale factor NUM/DEN fixed at compile time: the
+// phase tables are constexpr and the tap loops unrolled. Only the
+// LANCZOS_SPECS combinations (a = 2/3/4, scale 2/3/4/1.5, and bilinear /
+// bicubic at 2 and 1.5) are instantiated; lanczos() dispatches to them
+// whenever the sizes match exactly
+template <int32_t A, int32_t NUM, int32_t DEN>
+uint8_t *lanczos_resize(uint8_t *in, int32_t in_w, int32_t in_h, int32_t threads = 0);
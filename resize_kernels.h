@@ -0,0 +1,476 @@
+#pragma once
+
+// Internal interface between the resize engine and its row kernels
+
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#include "resize.h"
+
+// coefficient rows in a phase bank are padded with zeros to this many taps
+#define TAPS_ALIGN 8
+
+// The horizontal kernels may read in_row[x] for -pad <= x < in_w + pad (x
+// in pixels): a padded row view with the border mode already applied, see
+// border_pad_row(). Taps beyond it are clamped, so pad = 0 is BORDER_CLAMP
+
+// one input row (uint8) -> out_w samples (int16, scaled by 1 << INTER_BITS)
+typedef void (*horizontal_row_fn)(
+    uint8_t *in_row, int32_t in_w, int32_t pad,
+    int16_t *inter_row, int32_t out_w,
+    lanczos_phases *phases
+);
+
+// taps intermediate rows (int16) -> one output row (uint8)
+typedef void (*vertical_row_fn)(
+    int16_t **rows, int16_t *w, int32_t taps,
+    uint8_t *out_row, int32_t out_w
+);
+
+// one row of interleaved pixels (channels = 2..4) -> out_w pixels in the
+// same layout, every channel filtered with the same taps in one pass
+typedef void (*horizontal_row_interleaved_fn)(
+    uint8_t *in_row, int32_t in_w, int32_t pad, int32_t channels,
+    int16_t *inter_row, int32_t out_w,
+    lanczos_phases *phases
+);
+
+// integer scale factors the nearest neighbor kernels shuffle with SIMD
+#define NEAREST_MAX_FACTOR 16
+
+// Nearest neighbor columns: output pixel x copies the input pixel at byte
+// src[x] of the row. When out_w is factor * in_w, 16 output bytes at a
+// time are one shuffle of the 16 input bytes at some offset, and the
+// shuffles repeat every period blocks (a multiple of 4, so 2 or 4 blocks in
+// a row have contiguous masks): block b reads in_row + (b / period) *
+// advance + start[b % period] through masks[b % period]. The first
+// simd_blocks blocks only read inside the row. With AVX-512 VBMI, 4 blocks
+// from phase p on are one vpermb of the 64 bytes at start[p], through
+// masks_wide + p * 16, for the first wide_blocks blocks
+struct nearest_columns {
+    int32_t in_w;
+    int32_t out_w;
+    int32_t channels;
+    int32_t *src;       // out_w
+    int32_t factor;     // 0 if out_w isn't an integer multiple of in_w
+    int32_t period;
+    int32_t advance;
+    int32_t *start;     // period
+    int8_t *masks;      // period x 16
+    int8_t *masks_wide; // period / 4 x 64
+    int32_t simd_blocks;
+    int32_t wide_blocks;    // a multiple of 4
+};
+
+// one input row -> out_w nearest neighbor pixels
+typedef void (*nearest_row_fn)(uint8_t *in_row, uint8_t *out_row, nearest_columns *columns);
+
+void nearest_row_sse41(uint8_t *in_row, uint8_t *out_row, nearest_columns *columns);
+void nearest_row_avx2(uint8_t *in_row, uint8_t *out_row, nearest_columns *columns);
+void nearest_row_avx512bw(uint8_t *in_row, uint8_t *out_row, nearest_columns *columns);
+void nearest_row_avx512vbmi(uint8_t *in_row, uint8_t *out_row, nearest_columns *columns);
+
+nearest_row_fn nearest_row_active();
+
+struct resize_kernels {
+    horizontal_row_fn horizontal_row;
+    vertical_row_fn vertical_row;
+    horizontal_row_interleaved_fn horizontal_row_interleaved;
+};
+
+extern const resize_kernels kernels_scalar;
+extern const resize_kernels kernels_sse41;
+extern const resize_kernels kernels_avx2;
+extern const resize_kernels kernels_avx512bw;
+
+const resize_kernels *resize_kernels_active();
+
+// The same three kernels for uint16 and float pixels (T), filtering in float:
+// float intermediate rows, weights from phases->coeffs_f. Sums are in a
+// different order in the SIMD horizontal kernels, so their results are
+// within float rounding of the scalar ones rather than bit-exact
+template <typename T>
+struct resize_kernels_float {
+    void (*horizontal_row)(
+        T *in_row, int32_t in_w, int32_t pad,
+        float *inter_row, int32_t out_w,
+        lanczos_phases *phases
+    );
+    void (*vertical_row)(
+        float **rows, float *w, int32_t taps,
+        T *out_row, int32_t out_w
+    );
+    void (*horizontal_row_interleaved)(
+        T *in_row, int32_t in_w, int32_t pad, int32_t channels,
+        float *inter_row, int32_t out_w,
+        lanczos_phases *phases
+    );
+};
+
+template <typename T>
+const resize_kernels_float<T> *resize_kernels_float_isa(resize_isa isa);
+
+// What the engine filters a pixel type with: uint8 in fixed point (int16
+// rows between the passes, int32 sums), wider types in float
+template <typename T>
+struct pixel_traits {
+    typedef float inter;
+    typedef resize_kernels_float<T> kernels;
+    static float *coeffs(lanczos_phases *phases) { return phases->coeffs_f; }
+};
+
+template <>
+struct pixel_traits<uint8_t> {
+    typedef int16_t inter;
+    typedef resize_kernels kernels;
+    static int16_t *coeffs(lanczos_phases *phases) { return phases->coeffs; }
+};
+
+// Phase bank and row kernels for the scale p/q (lowest terms) and a: the
+// compile-time specialized ones if p/q and a are in LANCZOS_SPECS, else the
+// cached runtime bank with the active kernels. False if a is invalid
+bool lanczos_bank(int32_t p, int32_t q, int32_t a, lanczos_phases **phases, const resize_kernels **kernels);
+
+// Resizes into out, exactly out_w x out_h, with the bank of the scale p/q
+// (lowest terms), also for planes whose size isn't in * p / q, e.g.
+// subsampled chroma rounded up from the luma size. Strides are in bytes.
+// a = 0 is nearest neighbor
+bool resize_plane(
+    uint8_t *in, int32_t in_w, int32_t in_h, int32_t in_stride, int32_t channels,
+    uint8_t *out, int32_t out_w, int32_t out_h, int32_t out_stride,
+    int32_t p, int32_t q, int32_t a,
+    resize_border border, uint8_t border_value,
+    int32_t threads
+);
+
+// Sample of an axis of n standing in for position i, which may be past the
+// edges. -1 for BORDER_CONSTANT there
+int32_t border_index(int32_t i, int32_t n, resize_border border);
+
+// Columns to pad on each side of the input rows so that no horizontal
+// kernel of the bank has to clamp, see border_pad_row()
+int32_t border_pad(lanczos_phases *phases, int32_t in_w, int32_t out_w);
+
+// Padded row view of in_row: padded + pad * channels holds the row, the pad
+// pixels on each side its border. Built once per input row, the kernels then
+// filter every output as interior, whatever the mode. For uint8, uint16 and
+// float pixels
+template <typename T>
+void border_pad_row(
+    T *in_row, int32_t in_w, int32_t channels, int32_t pad,
+    resize_border border, T value, T *padded
+);
+
+// (a, scale numerator, scale denominator) with compile-time specialized
+// kernels and phase tables, see lanczos_resize(). a may be a FILTER_*
+#define LANCZOS_SPECS(X) \
+    X(2, 2, 1) X(2, 3, 1) X(2, 4, 1) X(2, 3, 2) \
+    X(3, 2, 1) X(3, 3, 1) X(3, 4, 1) X(3, 3, 2) \
+    X(4, 2, 1) X(4, 3, 1) X(4, 4, 1) X(4, 3, 2) \
+    X(FILTER_BILINEAR, 2, 1) X(FILTER_BILINEAR, 3, 2) \
+    X(FILTER_BICUBIC, 2, 1) X(FILTER_BICUBIC, 3, 2)
+
+// half width of the kernel of a filter, see resize_filter_get()
+static inline constexpr int32_t filter_support(int32_t a) {
+    return a == FILTER_BILINEAR ? 1 : a == FILTER_BICUBIC ? 2 : a;
+}
+
+// kernels with the taps, phase count and step of the bank fixed at compile time
+template <int32_t A, int32_t NUM, int32_t DEN>
+const resize_kernels *resize_kernels_spec(resize_isa isa);
+
+static inline constexpr int32_t align_taps(int32_t taps) {
+    return (taps + TAPS_ALIGN - 1) / TAPS_ALIGN * TAPS_ALIGN;
+}
+
+static inline int16_t horizontal_round(int32_t pixel) {
+    pixel = (pixel + (1 << (INT_SCALE_BITS - INTER_BITS - 1))) >> (INT_SCALE_BITS - INTER_BITS);
+    return clamp(pixel, INT16_MIN, INT16_MAX);
+}
+
+// single output sample of the horizontal pass, its window src[0 .. taps)
+// inside the row
+static inline int16_t horizontal_pixel(uint8_t *src, int16_t *w, int32_t taps) {
+    int32_t pixel = 0;
+    #pragma GCC unroll 16
+    for (int32_t t = 0; t < taps; t++) {
+        pixel += src[t] * w[t];
+    }
+    return horizontal_round(pixel);
+}
+
+// horizontal_pixel() for every channel of an interleaved pixel
+static inline void horizontal_pixel_interleaved(
+    uint8_t *src, int32_t channels, int16_t *w, int32_t taps, int16_t *out
+) {
+    for (int32_t c = 0; c < channels; c++) {
+        int32_t pixel = 0;
+        for (int32_t t = 0; t < taps; t++) {
+            pixel += src[t * channels + c] * w[t];
+        }
+        out[c] = horizontal_round(pixel);
+    }
+}
+
+// input column of the first tap of output x
+static inline int32_t phase_start(lanczos_phases *phases, int32_t x) {
+    return x / phases->num_phases * phases->step + phases->offset[x % phases->num_phases];
+}
+
+// Outputs [*x0, *x1) whose input window [start, start + width) lies inside
+// the readable columns [lo, hi), so the row kernels filter them without any
+// clamping. Starts never decrease with x, so the rest is a few outputs at
+// each end, found by scanning in from both sides
+static inline void interior_span(
+    lanczos_phases *phases, int32_t width, int32_t lo, int32_t hi, int32_t out_w,
+    int32_t *x0, int32_t *x1
+) {
+    int32_t x = 0;
+    while (x < out_w && phase_start(phases, x) < lo) x++;
+    *x0 = x;
+
+    x = out_w;
+    while (x > *x0 && phase_start(phases, x - 1) + width > hi) x--;
+    *x1 = x;
+}
+
+// Outputs [x, x_end) of the horizontal pass with the taps clamped to the
+// readable columns [lo, hi), starting at phase *p of the period at input
+// column *base and advancing both. The row kernels run it on the borders
+// left and right of their interior_span()
+static inline void horizontal_border(
+    uint8_t *in_row, int32_t lo, int32_t hi, int32_t channels,
+    int16_t *inter_row, int32_t x, int32_t x_end,
+    lanczos_phases *phases, int32_t *base, int32_t *p
+) {
+    for (; x < x_end; x++) {
+        int16_t *w = phases->coeffs + *p * phases->stride;
+        int32_t start = *base + phases->offset[*p];
+
+        for (int32_t c = 0; c < channels; c++) {
+            int32_t pixel = 0;
+            for (int32_t t = 0; t < phases->taps; t++) {
+                int32_t in_x = clamp(start + t, lo, hi - 1);
+                pixel += in_row[in_x * channels + c] * w[t];
+            }
+            inter_row[x * channels + c] = horizontal_round(pixel);
+        }
+
+        if (++*p == phases->num_phases) {
+            *p = 0;
+            *base += phases->step;
+        }
+    }
+}
+
+static inline uint8_t vertical_pixel(int16_t **rows, int16_t *w, int32_t taps, int32_t x) {
+    const int32_t shift = INT_SCALE_BITS + INTER_BITS;
+
+    int32_t pixel = 0;
+    #pragma GCC unroll 16
+    for (int32_t t = 0; t < taps; t++) {
+        pixel += rows[t][x] * w[t];
+    }
+
+    pixel = (pixel + (1 << (shift - 1))) >> shift;
+    return clamp(pixel, 0, 255);
+}
+
+// The row kernels are templates over the shape of the phase bank: a non-zero
+// TAPS / NUM_PHASES / STEP replaces the value read from the bank, so the tap
+// loops get constant trip counts and are unrolled. <0, 0, 0> is the generic
+// kernel used for any bank
+
+template <int32_t TAPS, int32_t NUM_PHASES, int32_t STEP>
+static void horizontal_row_scalar(
+    uint8_t *in_row, int32_t in_w, int32_t pad,
+    int16_t *inter_row, int32_t out_w,
+    lanczos_phases *phases
+) {
+    const int32_t taps = TAPS ? TAPS : phases->taps;
+    const int32_t stride = TAPS ? align_taps(TAPS) : phases->stride;
+    const int32_t num_phases = NUM_PHASES ? NUM_PHASES : phases->num_phases;
+    const int32_t step = STEP ? STEP : phases->step;
+
+    int32_t x0, x1;
+    interior_span(phases, taps, -pad, in_w + pad, out_w, &x0, &x1);
+
+    int32_t base = 0;
+    int32_t p = 0;
+    horizontal_border(in_row, -pad, in_w + pad, 1, inter_row, 0, x0, phases, &base, &p);
+
+    for (int32_t x = x0; x < x1; x++) {
+        int16_t *w = phases->coeffs + p * stride;
+        int32_t start = base + phases->offset[p];
+
+        inter_row[x] = horizontal_pixel(in_row + start, w, taps);
+
+        if (++p == num_phases) {
+            p = 0;
+            base += step;
+        }
+    }
+
+    horizontal_border(in_row, -pad, in_w + pad, 1, inter_row, x1, out_w, phases, &base, &p);
+}
+
+template <int32_t TAPS>
+static void vertical_row_scalar(
+    int16_t **rows, int16_t *w, int32_t taps,
+    uint8_t *out_row, int32_t out_w
+) {
+    if (TAPS) taps = TAPS;
+
+    for (int32_t x = 0; x < out_w; x++) {
+        out_row[x] = vertical_pixel(rows, w, taps, x);
+    }
+}
+
+static inline void horizontal_row_interleaved_scalar(
+    uint8_t *in_row, int32_t in_w, int32_t pad, int32_t channels,
+    int16_t *inter_row, int32_t out_w,
+    lanczos_phases *phases
+) {
+    int32_t x0, x1;
+    interior_span(phases, phases->taps, -pad, in_w + pad, out_w, &x0, &x1);
+
+    int32_t base = 0;
+    int32_t p = 0;
+    horizontal_border(in_row, -pad, in_w + pad, channels, inter_row, 0, x0, phases, &base, &p);
+
+    for (int32_t x = x0; x < x1; x++) {
+        int16_t *w = phases->coeffs + p * phases->stride;
+        int32_t start = base + phases->offset[p];
+
+        horizontal_pixel_interleaved(in_row + start * channels, channels, w, phases->taps, inter_row + x * channels);
+
+        if (++p == phases->num_phases) {
+            p = 0;
+            base += phases->step;
+        }
+    }
+
+    horizontal_border(in_row, -pad, in_w + pad, channels, inter_row, x1, out_w, phases, &base, &p);
+}
+
+// output pixels x0..out_w through the src table
+static inline void nearest_pixels(uint8_t *in_row, uint8_t *out_row, nearest_columns *columns, int32_t x0) {
+    int32_t *src = columns->src;
+    int32_t out_w = columns->out_w;
+    switch (columns->channels) {
+    case 1:
+        for (int32_t x = x0; x < out_w; x++) out_row[x] = in_row[src[x]];
+        break;
+    case 2:
+        for (int32_t x = x0; x < out_w; x++) memcpy(out_row + x * 2, in_row + src[x], 2);
+        break;
+    case 3:
+        for (int32_t x = x0; x < out_w; x++) memcpy(out_row + x * 3, in_row + src[x], 3);
+        break;
+    default:
+        for (int32_t x = x0; x < out_w; x++) memcpy(out_row + x * 4, in_row + src[x], 4);
+        break;
+    }
+}
+
+/* uint16 / float */
+
+// rounded to nearest even like cvtps2dq, so the SIMD stores match
+static inline void store_pixel(float v, uint16_t *dst) {
+    *dst = v <= 0 ? 0 : v >= UINT16_MAX ? UINT16_MAX : (uint16_t)lrintf(v);
+}
+
+static inline void store_pixel(float v, float *dst) {
+    *dst = v;
+}
+
+// horizontal_border() of the float pipeline
+template <typename T>
+static inline void horizontal_border_float(
+    T *in_row, int32_t lo, int32_t hi, int32_t channels,
+    float *inter_row, int32_t x, int32_t x_end,
+    lanczos_phases *phases, int32_t *base, int32_t *p
+) {
+    for (; x < x_end; x++) {
+        float *w = phases->coeffs_f + *p * phases->stride;
+        int32_t start = *base + phases->offset[*p];
+
+        for (int32_t c = 0; c < channels; c++) {
+            float pixel = 0;
+            for (int32_t t = 0; t < phases->taps; t++) {
+                int32_t in_x = clamp(start + t, lo, hi - 1);
+                pixel += in_row[in_x * channels + c] * w[t];
+            }
+            inter_row[x * channels + c] = pixel;
+        }
+
+        if (++*p == phases->num_phases) {
+            *p = 0;
+            *base += phases->step;
+        }
+    }
+}
+
+template <typename T>
+static inline void vertical_pixel_float(float **rows, float *w, int32_t taps, int32_t x, T *dst) {
+    float pixel = 0;
+    for (int32_t t = 0; t < taps; t++) {
+        pixel += rows[t][x] * w[t];
+    }
+    store_pixel(pixel, dst);
+}
+
+// planar is the interleaved kernel with one channel, the SIMD ones differ
+template <typename T>
+static void horizontal_row_interleaved_float_scalar(
+    T *in_row, int32_t in_w, int32_t pad, int32_t channels,
+    float *inter_row, int32_t out_w,
+    lanczos_phases *phases
+) {
+    int32_t x0, x1;
+    interior_span(phases, phases->taps, -pad, in_w + pad, out_w, &x0, &x1);
+
+    int32_t base = 0;
+    int32_t p = 0;
+    horizontal_border_float(in_row, -pad, in_w + pad, channels, inter_row, 0, x0, phases, &base, &p);
+
+    for (int32_t x = x0; x < x1; x++) {
+        float *w = phases->coeffs_f + p * phases->stride;
+        T *src = in_row + (base + phases->offset[p]) * channels;
+
+        for (int32_t c = 0; c < channels; c++) {
+            float pixel = 0;
+            for (int32_t t = 0; t < phases->taps; t++) {
+                pixel += src[t * channels + c] * w[t];
+            }
+            inter_row[x * channels + c] = pixel;
+        }
+
+        if (++p == phases->num_phases) {
+            p = 0;
+            base += phases->step;
+        }
+    }
+
+    horizontal_border_float(in_row, -pad, in_w + pad, channels, inter_row, x1, out_w, phases, &base, &p);
+}
+
+template <typename T>
+static void horizontal_row_float_scalar(
+    T *in_row, int32_t in_w, int32_t pad,
+    float *inter_row, int32_t out_w,
+    lanczos_phases *phases
+) {
+    horizontal_row_interleaved_float_scalar(in_row, in_w, pad, 1, inter_row, out_w, phases);
+}
+
+template <typename T>
+static void vertical_row_float_scalar(
+    float **rows, float *w, int32_t taps,
+    T *out_row, int32_t out_w
+) {
+    for (int32_t x = 0; x < out_w; x++) {
+        vertical_pixel_float(rows, w, taps, x, out_row + x);
+    }
+}
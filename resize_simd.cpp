@@ -0,0 +1,1044 @@
+// SSE4.1 / AVX2 / AVX-512BW row kernels. Each function is compiled for its
+// own target so the binary runs everywhere and the dispatcher in resize.cpp
+// picks the widest one the host supports. Results are bit-exact with the
+// scalar kernels: same int32 accumulation, rounding and saturation. The
+// uint16 / float kernels at the end accumulate in float, see
+// resize_kernels_float.
+
+#include <string.h>
+#include <immintrin.h>
+
+#include "resize_kernels.h"
+
+static inline int64_t load_u64(uint8_t *p) {
+    int64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+// the two weights of taps t, t+1 in every int32 lane, for madd on interleaved rows
+static inline int32_t weight_pair(int16_t *w, int32_t t, int32_t taps) {
+    uint16_t w0 = w[t];
+    uint16_t w1 = t + 1 < taps ? w[t + 1] : 0;
+    return w0 | ((uint32_t)w1 << 16);
+}
+
+// Gathers the (start, coeffs) of the next n outputs, advancing the phase
+static inline void next_outputs(
+    lanczos_phases *phases, int32_t stride, int32_t num_phases, int32_t step,
+    int32_t n,
+    int32_t *base, int32_t *p,
+    int32_t *starts, int16_t **ws
+) {
+    for (int32_t i = 0; i < n; i++) {
+        ws[i] = phases->coeffs + *p * stride;
+        starts[i] = *base + phases->offset[*p];
+
+        if (++*p == num_phases) {
+            *p = 0;
+            *base += step;
+        }
+    }
+}
+
+// The planar kernels load stride bytes per output, so their interior_span()
+// is computed with that width. Outputs the loads would take outside the row,
+// and the last few that don't fill a register, go to horizontal_border()
+
+// see horizontal_row_scalar() for the meaning of the template arguments
+#define BANK_SHAPE \
+    const int32_t stride = TAPS ? align_taps(TAPS) : phases->stride; \
+    const int32_t num_phases = NUM_PHASES ? NUM_PHASES : phases->num_phases; \
+    const int32_t step = STEP ? STEP : phases->step;
+
+// Interleaved pixels are filtered channel-parallel: a pshufb spreads taps
+// t, t + 1 of every channel into int16 pairs, channel c in int32 lane c, so
+// one madd with the weight pair accumulates all channels at once. The loads
+// are 16 bytes per 4 taps, i.e. up to 4 channels
+static inline void interleave_mask(int32_t channels, int32_t t, int8_t *mask) {
+    for (int32_t c = 0; c < 4; c++) {
+        for (int32_t j = 0; j < 2; j++) {
+            mask[4*c + 2*j] = c < channels ? (t + j) * channels + c : -128;
+            mask[4*c + 2*j + 1] = -128;
+        }
+    }
+}
+
+// the 16 byte load of the last 4 taps ends (start + stride - 4) * channels + 16
+// bytes into the row: the interior_span() width in pixels, rounded up
+static inline int32_t interleaved_width(int32_t stride, int32_t channels) {
+    return stride - 4 + (16 + channels - 1) / channels;
+}
+
+// the first channels int16 of a packed pixel
+static inline void store_channels(int16_t *dst, int64_t px, int32_t channels) {
+    memcpy(dst, &px, channels * sizeof(int16_t));
+}
+
+/* SSE4.1 */
+
+__attribute__((target("sse4.1")))
+static inline __m128i madd_taps_sse41(uint8_t *src, int16_t *w, int32_t stride) {
+    __m128i acc = _mm_setzero_si128();
+    #pragma GCC unroll 8
+    for (int32_t c = 0; c < stride; c += 8) {
+        __m128i px = _mm_cvtepu8_epi16(_mm_loadl_epi64((__m128i *)(src + c)));
+        acc = _mm_add_epi32(acc, _mm_madd_epi16(px, _mm_loadu_si128((__m128i *)(w + c))));
+    }
+    return acc;
+}
+
+template <int32_t TAPS, int32_t NUM_PHASES, int32_t STEP>
+__attribute__((target("sse4.1")))
+static void horizontal_row_sse41(
+    uint8_t *in_row, int32_t in_w, int32_t pad,
+    int16_t *inter_row, int32_t out_w,
+    lanczos_phases *phases
+) {
+    const __m128i round = _mm_set1_epi32(1 << (INT_SCALE_BITS - INTER_BITS - 1));
+    BANK_SHAPE
+    int32_t starts[4];
+    int16_t *ws[4];
+
+    int32_t x0, x1;
+    interior_span(phases, stride, -pad, in_w + pad, out_w, &x0, &x1);
+
+    int32_t base = 0;
+    int32_t p = 0;
+    horizontal_border(in_row, -pad, in_w + pad, 1, inter_row, 0, x0, phases, &base, &p);
+
+    int32_t x = x0;
+    for (; x + 4 <= x1; x += 4) {
+        next_outputs(phases, stride, num_phases, step, 4, &base, &p, starts, ws);
+
+        __m128i a0 = madd_taps_sse41(in_row + starts[0], ws[0], stride);
+        __m128i a1 = madd_taps_sse41(in_row + starts[1], ws[1], stride);
+        __m128i a2 = madd_taps_sse41(in_row + starts[2], ws[2], stride);
+        __m128i a3 = madd_taps_sse41(in_row + starts[3], ws[3], stride);
+
+        __m128i s = _mm_hadd_epi32(_mm_hadd_epi32(a0, a1), _mm_hadd_epi32(a2, a3));
+        s = _mm_srai_epi32(_mm_add_epi32(s, round), INT_SCALE_BITS - INTER_BITS);
+        _mm_storel_epi64((__m128i *)(inter_row + x), _mm_packs_epi32(s, s));
+    }
+
+    horizontal_border(in_row, -pad, in_w + pad, 1, inter_row, x, out_w, phases, &base, &p);
+}
+
+template <int32_t TAPS>
+__attribute__((target("sse4.1")))
+static void vertical_row_sse41(
+    int16_t **rows, int16_t *w, int32_t taps,
+    uint8_t *out_row, int32_t out_w
+) {
+    if (TAPS) taps = TAPS;
+    const int32_t shift = INT_SCALE_BITS + INTER_BITS;
+    const __m128i round = _mm_set1_epi32(1 << (shift - 1));
+    const __m128i zero = _mm_setzero_si128();
+
+    int32_t x = 0;
+    for (; x + 8 <= out_w; x += 8) {
+        __m128i lo = round;
+        __m128i hi = round;
+
+        #pragma GCC unroll 8
+        for (int32_t t = 0; t < taps; t += 2) {
+            __m128i r0 = _mm_loadu_si128((__m128i *)(rows[t] + x));
+            __m128i r1 = t + 1 < taps ? _mm_loadu_si128((__m128i *)(rows[t + 1] + x)) : zero;
+            __m128i wp = _mm_set1_epi32(weight_pair(w, t, taps));
+
+            lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(r0, r1), wp));
+            hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(r0, r1), wp));
+        }
+
+        lo = _mm_srai_epi32(lo, shift);
+        hi = _mm_srai_epi32(hi, shift);
+        __m128i px = _mm_packs_epi32(lo, hi);
+        _mm_storel_epi64((__m128i *)(out_row + x), _mm_packus_epi16(px, px));
+    }
+
+    for (; x < out_w; x++) {
+        out_row[x] = vertical_pixel(rows, w, taps, x);
+    }
+}
+
+__attribute__((target("sse4.1")))
+static inline __m128i madd_taps_interleaved_sse41(
+    uint8_t *src, int16_t *w, int32_t stride, int32_t channels,
+    __m128i m01, __m128i m23
+) {
+    __m128i acc = _mm_setzero_si128();
+    for (int32_t t = 0; t < stride; t += 8) {
+        __m128i wv = _mm_loadu_si128((__m128i *)(w + t));
+        __m128i v0 = _mm_loadu_si128((__m128i *)(src + t * channels));
+        __m128i v1 = _mm_loadu_si128((__m128i *)(src + (t + 4) * channels));
+
+        acc = _mm_add_epi32(acc, _mm_madd_epi16(_mm_shuffle_epi8(v0, m01), _mm_shuffle_epi32(wv, 0x00)));
+        acc = _mm_add_epi32(acc, _mm_madd_epi16(_mm_shuffle_epi8(v0, m23), _mm_shuffle_epi32(wv, 0x55)));
+        acc = _mm_add_epi32(acc, _mm_madd_epi16(_mm_shuffle_epi8(v1, m01), _mm_shuffle_epi32(wv, 0xaa)));
+        acc = _mm_add_epi32(acc, _mm_madd_epi16(_mm_shuffle_epi8(v1, m23), _mm_shuffle_epi32(wv, 0xff)));
+    }
+    return acc;
+}
+
+__attribute__((target("sse4.1")))
+static void horizontal_row_interleaved_sse41(
+    uint8_t *in_row, int32_t in_w, int32_t pad, int32_t channels,
+    int16_t *inter_row, int32_t out_w,
+    lanczos_phases *phases
+) {
+    const __m128i round = _mm_set1_epi32(1 << (INT_SCALE_BITS - INTER_BITS - 1));
+    const int32_t stride = phases->stride;
+    int8_t mask[16];
+    interleave_mask(channels, 0, mask);
+    const __m128i m01 = _mm_loadu_si128((__m128i *)mask);
+    interleave_mask(channels, 2, mask);
+    const __m128i m23 = _mm_loadu_si128((__m128i *)mask);
+
+    int32_t x0, x1;
+    interior_span(phases, interleaved_width(stride, channels), -pad, in_w + pad, out_w, &x0, &x1);
+
+    int32_t base = 0;
+    int32_t p = 0;
+    horizontal_border(in_row, -pad, in_w + pad, channels, inter_row, 0, x0, phases, &base, &p);
+
+    for (int32_t x = x0; x < x1; x++) {
+        int16_t *w = phases->coeffs + p * stride;
+        int32_t start = base + phases->offset[p];
+
+        __m128i s = madd_taps_interleaved_sse41(in_row + start * channels, w, stride, channels, m01, m23);
+        s = _mm_srai_epi32(_mm_add_epi32(s, round), INT_SCALE_BITS - INTER_BITS);
+        store_channels(inter_row + x * channels, _mm_cvtsi128_si64(_mm_packs_epi32(s, s)), channels);
+
+        if (++p == phases->num_phases) {
+            p = 0;
+            base += phases->step;
+        }
+    }
+
+    horizontal_border(in_row, -pad, in_w + pad, channels, inter_row, x1, out_w, phases, &base, &p);
+}
+
+const resize_kernels kernels_sse41 = {
+    horizontal_row_sse41<0, 0, 0>,
+    vertical_row_sse41<0>,
+    horizontal_row_interleaved_sse41
+};
+
+/* AVX2 */
+
+// two outputs per register, one per 128-bit lane
+__attribute__((target("avx2")))
+static inline __m256i madd_taps_avx2(
+    uint8_t *src0, int16_t *w0,
+    uint8_t *src1, int16_t *w1,
+    int32_t stride
+) {
+    __m256i acc = _mm256_setzero_si256();
+    #pragma GCC unroll 8
+    for (int32_t c = 0; c < stride; c += 8) {
+        __m128i px = _mm_unpacklo_epi64(
+            _mm_loadl_epi64((__m128i *)(src0 + c)),
+            _mm_loadl_epi64((__m128i *)(src1 + c))
+        );
+        __m256i w = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(_mm_loadu_si128((__m128i *)(w0 + c))),
+            _mm_loadu_si128((__m128i *)(w1 + c)),
+            1
+        );
+        acc = _mm256_add_epi32(acc, _mm256_madd_epi16(_mm256_cvtepu8_epi16(px), w));
+    }
+    return acc;
+}
+
+template <int32_t TAPS, int32_t NUM_PHASES, int32_t STEP>
+__attribute__((target("avx2")))
+static void horizontal_row_avx2(
+    uint8_t *in_row, int32_t in_w, int32_t pad,
+    int16_t *inter_row, int32_t out_w,
+    lanczos_phases *phases
+) {
+    const __m256i round = _mm256_set1_epi32(1 << (INT_SCALE_BITS - INTER_BITS - 1));
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    BANK_SHAPE
+    int32_t starts[8];
+    int16_t *ws[8];
+
+    int32_t x0, x1;
+    interior_span(phases, stride, -pad, in_w + pad, out_w, &x0, &x1);
+
+    int32_t base = 0;
+    int32_t p = 0;
+    horizontal_border(in_row, -pad, in_w + pad, 1, inter_row, 0, x0, phases, &base, &p);
+
+    int32_t x = x0;
+    for (; x + 8 <= x1; x += 8) {
+        next_outputs(phases, stride, num_phases, step, 8, &base, &p, starts, ws);
+
+        __m256i a[4];
+        for (int32_t i = 0; i < 4; i++) {
+            a[i] = madd_taps_avx2(
+                in_row + starts[2*i], ws[2*i],
+                in_row + starts[2*i + 1], ws[2*i + 1],
+                stride
+            );
+        }
+
+        // lane 0 ends up with outputs 0 2 4 6, lane 1 with 1 3 5 7
+        __m256i s = _mm256_hadd_epi32(_mm256_hadd_epi32(a[0], a[1]), _mm256_hadd_epi32(a[2], a[3]));
+        s = _mm256_permutevar8x32_epi32(s, order);
+        s = _mm256_srai_epi32(_mm256_add_epi32(s, round), INT_SCALE_BITS - INTER_BITS);
+
+        __m128i px = _mm_packs_epi32(_mm256_castsi256_si128(s), _mm256_extracti128_si256(s, 1));
+        _mm_storeu_si128((__m128i *)(inter_row + x), px);
+    }
+
+    horizontal_border(in_row, -pad, in_w + pad, 1, inter_row, x, out_w, phases, &base, &p);
+}
+
+template <int32_t TAPS>
+__attribute__((target("avx2")))
+static void vertical_row_avx2(
+    int16_t **rows, int16_t *w, int32_t taps,
+    uint8_t *out_row, int32_t out_w
+) {
+    if (TAPS) taps = TAPS;
+    const int32_t shift = INT_SCALE_BITS + INTER_BITS;
+    const __m256i round = _mm256_set1_epi32(1 << (shift - 1));
+    const __m256i zero = _mm256_setzero_si256();
+
+    int32_t x = 0;
+    for (; x + 16 <= out_w; x += 16) {
+        __m256i lo = round;
+        __m256i hi = round;
+
+        #pragma GCC unroll 8
+        for (int32_t t = 0; t < taps; t += 2) {
+            __m256i r0 = _mm256_loadu_si256((__m256i *)(rows[t] + x));
+            __m256i r1 = t + 1 < taps ? _mm256_loadu_si256((__m256i *)(rows[t + 1] + x)) : zero;
+            __m256i wp = _mm256_set1_epi32(weight_pair(w, t, taps));
+
+            lo = _mm256_add_epi32(lo, _mm256_madd_epi16(_mm256_unpacklo_epi16(r0, r1), wp));
+            hi = _mm256_add_epi32(hi, _mm256_madd_epi16(_mm256_unpackhi_epi16(r0, r1), wp));
+        }
+
+        // unpack/pack both work per lane, so the order is restored by the
+        // final 64-bit permute
+        lo = _mm256_srai_epi32(lo, shift);
+        hi = _mm256_srai_epi32(hi, shift);
+        __m256i px = _mm256_packs_epi32(lo, hi);
+        px = _mm256_permute4x64_epi64(_mm256_packus_epi16(px, px), 0x08);
+        _mm_storeu_si128((__m128i *)(out_row + x), _mm256_castsi256_si128(px));
+    }
+
+    for (; x < out_w; x++) {
+        out_row[x] = vertical_pixel(rows, w, taps, x);
+    }
+}
+
+// two outputs per register, one per 128-bit lane
+__attribute__((target("avx2")))
+static inline __m256i load_m128x2(void *lo, void *hi) {
+    return _mm256_inserti128_si256(
+        _mm256_castsi128_si256(_mm_loadu_si128((__m128i *)lo)),
+        _mm_loadu_si128((__m128i *)hi),
+        1
+    );
+}
+
+__attribute__((target("avx2")))
+static inline __m256i madd_taps_interleaved_avx2(
+    uint8_t **srcs, int16_t **ws, int32_t stride, int32_t channels,
+    __m256i m01, __m256i m23
+) {
+    __m256i acc = _mm256_setzero_si256();
+    for (int32_t t = 0; t < stride; t += 8) {
+        __m256i wv = load_m128x2(ws[0] + t, ws[1] + t);
+        __m256i v0 = load_m128x2(srcs[0] + t * channels, srcs[1] + t * channels);
+        __m256i v1 = load_m128x2(srcs[0] + (t + 4) * channels, srcs[1] + (t + 4) * channels);
+
+        acc = _mm256_add_epi32(acc, _mm256_madd_epi16(_mm256_shuffle_epi8(v0, m01), _mm256_shuffle_epi32(wv, 0x00)));
+        acc = _mm256_add_epi32(acc, _mm256_madd_epi16(_mm256_shuffle_epi8(v0, m23), _mm256_shuffle_epi32(wv, 0x55)));
+        acc = _mm256_add_epi32(acc, _mm256_madd_epi16(_mm256_shuffle_epi8(v1, m01), _mm256_shuffle_epi32(wv, 0xaa)));
+        acc = _mm256_add_epi32(acc, _mm256_madd_epi16(_mm256_shuffle_epi8(v1, m23), _mm256_shuffle_epi32(wv, 0xff)));
+    }
+    return acc;
+}
+
+__attribute__((target("avx2")))
+static void horizontal_row_interleaved_avx2(
+    uint8_t *in_row, int32_t in_w, int32_t pad, int32_t channels,
+    int16_t *inter_row, int32_t out_w,
+    lanczos_phases *phases
+) {
+    const __m256i round = _mm256_set1_epi32(1 << (INT_SCALE_BITS - INTER_BITS - 1));
+    const int32_t stride = phases->stride;
+    int8_t mask[16];
+    interleave_mask(channels, 0, mask);
+    const __m256i m01 = _mm256_broadcastsi128_si256(_mm_loadu_si128((__m128i *)mask));
+    interleave_mask(channels, 2, mask);
+    const __m256i m23 = _mm256_broadcastsi128_si256(_mm_loadu_si128((__m128i *)mask));
+    int32_t starts[2];
+    int16_t *ws[2];
+    uint8_t *srcs[2];
+
+    int32_t x0, x1;
+    interior_span(phases, interleaved_width(stride, channels), -pad, in_w + pad, out_w, &x0, &x1);
+
+    int32_t base = 0;
+    int32_t p = 0;
+    horizontal_border(in_row, -pad, in_w + pad, channels, inter_row, 0, x0, phases, &base, &p);
+
+    int32_t x = x0;
+    for (; x + 2 <= x1; x += 2) {
+        next_outputs(phases, stride, phases->num_phases, phases->step, 2, &base, &p, starts, ws);
+        for (int32_t i = 0; i < 2; i++) {
+            srcs[i] = in_row + starts[i] * channels;
+        }
+
+        __m256i s = madd_taps_interleaved_avx2(srcs, ws, stride, channels, m01, m23);
+        s = _mm256_srai_epi32(_mm256_add_epi32(s, round), INT_SCALE_BITS - INTER_BITS);
+        s = _mm256_packs_epi32(s, s);
+        store_channels(inter_row + x * channels, _mm256_extract_epi64(s, 0), channels);
+        store_channels(inter_row + (x + 1) * channels, _mm256_extract_epi64(s, 2), channels);
+    }
+
+    horizontal_border(in_row, -pad, in_w + pad, channels, inter_row, x, out_w, phases, &base, &p);
+}
+
+const resize_kernels kernels_avx2 = {
+    horizontal_row_avx2<0, 0, 0>,
+    vertical_row_avx2<0>,
+    horizontal_row_interleaved_avx2
+};
+
+/* AVX-512BW */
+
+// four outputs per register, one per 128-bit lane
+__attribute__((target("avx512bw")))
+static inline __m512i madd_taps_avx512bw(uint8_t **srcs, int16_t **ws, int32_t stride) {
+    __m512i acc = _mm512_setzero_si512();
+    #pragma GCC unroll 8
+    for (int32_t c = 0; c < stride; c += 8) {
+        __m256i px = _mm256_set_epi64x(
+            load_u64(srcs[3] + c), load_u64(srcs[2] + c),
+            load_u64(srcs[1] + c), load_u64(srcs[0] + c)
+        );
+        __m512i w = _mm512_castsi128_si512(_mm_loadu_si128((__m128i *)(ws[0] + c)));
+        w = _mm512_inserti32x4(w, _mm_loadu_si128((__m128i *)(ws[1] + c)), 1);
+        w = _mm512_inserti32x4(w, _mm_loadu_si128((__m128i *)(ws[2] + c)), 2);
+        w = _mm512_inserti32x4(w, _mm_loadu_si128((__m128i *)(ws[3] + c)), 3);
+        acc = _mm512_add_epi32(acc, _mm512_madd_epi16(_mm512_cvtepu8_epi16(px), w));
+    }
+
+    // every element of a lane ends up holding that lane's total
+    acc = _mm512_add_epi32(acc, _mm512_shuffle_epi32(acc, _MM_PERM_BADC));
+    acc = _mm512_add_epi32(acc, _mm512_shuffle_epi32(acc, _MM_PERM_CDAB));
+    return acc;
+}
+
+template <int32_t TAPS, int32_t NUM_PHASES, int32_t STEP>
+__attribute__((target("avx512bw")))
+static void horizontal_row_avx512bw(
+    uint8_t *in_row, int32_t in_w, int32_t pad,
+    int16_t *inter_row, int32_t out_w,
+    lanczos_phases *phases
+) {
+    static const int32_t order_idx[16] = { 0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15 };
+    const __m512i order = _mm512_loadu_si512(order_idx);
+    const __m512i round = _mm512_set1_epi32(1 << (INT_SCALE_BITS - INTER_BITS - 1));
+    BANK_SHAPE
+    int32_t starts[16];
+    int16_t *ws[16];
+    uint8_t *srcs[16];
+
+    int32_t x0, x1;
+    interior_span(phases, stride, -pad, in_w + pad, out_w, &x0, &x1);
+
+    int32_t base = 0;
+    int32_t p = 0;
+    horizontal_border(in_row, -pad, in_w + pad, 1, inter_row, 0, x0, phases, &base, &p);
+
+    int32_t x = x0;
+    for (; x + 16 <= x1; x += 16) {
+        next_outputs(phases, stride, num_phases, step, 16, &base, &p, starts, ws);
+
+        for (int32_t i = 0; i < 16; i++) {
+            srcs[i] = in_row + starts[i];
+        }
+
+        // register k holds outputs 4k..4k+3, blend output 4k+l into element k of lane l
+        __m512i s = madd_taps_avx512bw(srcs, ws, stride);
+        s = _mm512_mask_blend_epi32(0x2222, s, madd_taps_avx512bw(srcs + 4, ws + 4, stride));
+        s = _mm512_mask_blend_epi32(0x4444, s, madd_taps_avx512bw(srcs + 8, ws + 8, stride));
+        s = _mm512_mask_blend_epi32(0x8888, s, madd_taps_avx512bw(srcs + 12, ws + 12, stride));
+        s = _mm512_permutexvar_epi32(order, s);
+
+        s = _mm512_srai_epi32(_mm512_add_epi32(s, round), INT_SCALE_BITS - INTER_BITS);
+        _mm256_storeu_si256((__m256i *)(inter_row + x), _mm512_cvtsepi32_epi16(s));
+    }
+
+    horizontal_border(in_row, -pad, in_w + pad, 1, inter_row, x, out_w, phases, &base, &p);
+}
+
+template <int32_t TAPS>
+__attribute__((target("avx512bw")))
+static void vertical_row_avx512bw(
+    int16_t **rows, int16_t *w, int32_t taps,
+    uint8_t *out_row, int32_t out_w
+) {
+    if (TAPS) taps = TAPS;
+    const int32_t shift = INT_SCALE_BITS + INTER_BITS;
+    const __m512i round = _mm512_set1_epi32(1 << (shift - 1));
+    const __m512i zero = _mm512_setzero_si512();
+    const __m512i order = _mm512_set_epi64(7, 5, 3, 1, 6, 4, 2, 0);
+
+    int32_t x = 0;
+    for (; x + 32 <= out_w; x += 32) {
+        __m512i lo = round;
+        __m512i hi = round;
+
+        #pragma GCC unroll 8
+        for (int32_t t = 0; t < taps; t += 2) {
+            __m512i r0 = _mm512_loadu_si512(rows[t] + x);
+            __m512i r1 = t + 1 < taps ? _mm512_loadu_si512(rows[t + 1] + x) : zero;
+            __m512i wp = _mm512_set1_epi32(weight_pair(w, t, taps));
+
+            lo = _mm512_add_epi32(lo, _mm512_madd_epi16(_mm512_unpacklo_epi16(r0, r1), wp));
+            hi = _mm512_add_epi32(hi, _mm512_madd_epi16(_mm512_unpackhi_epi16(r0, r1), wp));
+        }
+
+        lo = _mm512_srai_epi32(lo, shift);
+        hi = _mm512_srai_epi32(hi, shift);
+        __m512i px = _mm512_packs_epi32(lo, hi);
+        px = _mm512_permutexvar_epi64(order, _mm512_packus_epi16(px, px));
+        _mm256_storeu_si256((__m256i *)(out_row + x), _mm512_castsi512_si256(px));
+    }
+
+    for (; x < out_w; x++) {
+        out_row[x] = vertical_pixel(rows, w, taps, x);
+    }
+}
+
+// four outputs per register, one per 128-bit lane
+__attribute__((target("avx512bw")))
+static inline __m512i load_m128x4(void **ptrs, int32_t offset) {
+    __m512i v = _mm512_castsi128_si512(_mm_loadu_si128((__m128i *)((uint8_t *)ptrs[0] + offset)));
+    v = _mm512_inserti32x4(v, _mm_loadu_si128((__m128i *)((uint8_t *)ptrs[1] + offset)), 1);
+    v = _mm512_inserti32x4(v, _mm_loadu_si128((__m128i *)((uint8_t *)ptrs[2] + offset)), 2);
+    v = _mm512_inserti32x4(v, _mm_loadu_si128((__m128i *)((uint8_t *)ptrs[3] + offset)), 3);
+    return v;
+}
+
+__attribute__((target("avx512bw")))
+static inline __m512i madd_taps_interleaved_avx512bw(
+    uint8_t **srcs, int16_t **ws, int32_t stride, int32_t channels,
+    __m512i m01, __m512i m23
+) {
+    __m512i acc = _mm512_setzero_si512();
+    for (int32_t t = 0; t < stride; t += 8) {
+        __m512i wv = load_m128x4((void **)ws, t * sizeof(int16_t));
+        __m512i v0 = load_m128x4((void **)srcs, t * channels);
+        __m512i v1 = load_m128x4((void **)srcs, (t + 4) * channels);
+
+        acc = _mm512_add_epi32(acc, _mm512_madd_epi16(_mm512_shuffle_epi8(v0, m01), _mm512_shuffle_epi32(wv, _MM_PERM_AAAA)));
+        acc = _mm512_add_epi32(acc, _mm512_madd_epi16(_mm512_shuffle_epi8(v0, m23), _mm512_shuffle_epi32(wv, _MM_PERM_BBBB)));
+        acc = _mm512_add_epi32(acc, _mm512_madd_epi16(_mm512_shuffle_epi8(v1, m01), _mm512_shuffle_epi32(wv, _MM_PERM_CCCC)));
+        acc = _mm512_add_epi32(acc, _mm512_madd_epi16(_mm512_shuffle_epi8(v1, m23), _mm512_shuffle_epi32(wv, _MM_PERM_DDDD)));
+    }
+    return acc;
+}
+
+__attribute__((target("avx512bw")))
+static void horizontal_row_interleaved_avx512bw(
+    uint8_t *in_row, int32_t in_w, int32_t pad, int32_t channels,
+    int16_t *inter_row, int32_t out_w,
+    lanczos_phases *phases
+) {
+    const __m512i round = _mm512_set1_epi32(1 << (INT_SCALE_BITS - INTER_BITS - 1));
+    const int32_t stride = phases->stride;
+    int8_t mask[16];
+    interleave_mask(channels, 0, mask);
+    const __m512i m01 = _mm512_broadcast_i32x4(_mm_loadu_si128((__m128i *)mask));
+    interleave_mask(channels, 2, mask);
+    const __m512i m23 = _mm512_broadcast_i32x4(_mm_loadu_si128((__m128i *)mask));
+    int32_t starts[4];
+    int16_t *ws[4];
+    uint8_t *srcs[4];
+
+    int32_t x0, x1;
+    interior_span(phases, interleaved_width(stride, channels), -pad, in_w + pad, out_w, &x0, &x1);
+
+    int32_t base = 0;
+    int32_t p = 0;
+    horizontal_border(in_row, -pad, in_w + pad, channels, inter_row, 0, x0, phases, &base, &p);
+
+    int32_t x = x0;
+    for (; x + 4 <= x1; x += 4) {
+        next_outputs(phases, stride, phases->num_phases, phases->step, 4, &base, &p, starts, ws);
+        for (int32_t i = 0; i < 4; i++) {
+            srcs[i] = in_row + starts[i] * channels;
+        }
+
+        __m512i s = madd_taps_interleaved_avx512bw(srcs, ws, stride, channels, m01, m23);
+        s = _mm512_srai_epi32(_mm512_add_epi32(s, round), INT_SCALE_BITS - INTER_BITS);
+        __m256i px = _mm512_cvtsepi32_epi16(s);
+
+        if (channels == 4) {
+            _mm256_storeu_si256((__m256i *)(inter_row + x * channels), px);
+            continue;
+        }
+        int64_t packed[4];
+        _mm256_storeu_si256((__m256i *)packed, px);
+        for (int32_t i = 0; i < 4; i++) {
+            store_channels(inter_row + (x + i) * channels, packed[i], channels);
+        }
+    }
+
+    horizontal_border(in_row, -pad, in_w + pad, channels, inter_row, x, out_w, phases, &base, &p);
+}
+
+const resize_kernels kernels_avx512bw = {
+    horizontal_row_avx512bw<0, 0, 0>,
+    vertical_row_avx512bw<0>,
+    horizontal_row_interleaved_avx512bw
+};
+
+template <int32_t A, int32_t NUM, int32_t DEN>
+const resize_kernels *resize_kernels_spec(resize_isa isa) {
+    static const resize_kernels kernels[ISA_COUNT] = {
+        { horizontal_row_scalar<2 * filter_support(A), NUM, DEN>, vertical_row_scalar<2 * filter_support(A)>, horizontal_row_interleaved_scalar },
+        { horizontal_row_sse41<2 * filter_support(A), NUM, DEN>, vertical_row_sse41<2 * filter_support(A)>, horizontal_row_interleaved_sse41 },
+        { horizontal_row_avx2<2 * filter_support(A), NUM, DEN>, vertical_row_avx2<2 * filter_support(A)>, horizontal_row_interleaved_avx2 },
+        { horizontal_row_avx512bw<2 * filter_support(A), NUM, DEN>, vertical_row_avx512bw<2 * filter_support(A)>, horizontal_row_interleaved_avx512bw }
+    };
+    return &kernels[isa];
+}
+
+#define INSTANTIATE_SPEC(a, num, den) \
+    template const resize_kernels *resize_kernels_spec<a, num, den>(resize_isa isa);
+LANCZOS_SPECS(INSTANTIATE_SPEC)
+
+/* nearest neighbor, integer factors */
+
+// Blocks of 16 output bytes, each a pshufb of the 16 input bytes its
+// pixels come from, 2 / 4 blocks per register in the wider kernels. The
+// blocks past simd_blocks (whose loads would leave the row) and the
+// partial one at the end go through the src table
+__attribute__((target("sse4.1")))
+void nearest_row_sse41(uint8_t *in_row, uint8_t *out_row, nearest_columns *columns) {
+    int32_t b = 0;
+    int32_t phase = 0;
+    uint8_t *base = in_row;
+    for (; b < columns->simd_blocks; b++) {
+        __m128i v = _mm_loadu_si128((__m128i *)(base + columns->start[phase]));
+        __m128i mask = _mm_loadu_si128((__m128i *)(columns->masks + phase * 16));
+        _mm_storeu_si128((__m128i *)(out_row + b * 16), _mm_shuffle_epi8(v, mask));
+        if (++phase == columns->period) {
+            phase = 0;
+            base += columns->advance;
+        }
+    }
+    nearest_pixels(in_row, out_row, columns, b * 16 / columns->channels);
+}
+
+__attribute__((target("avx2")))
+void nearest_row_avx2(uint8_t *in_row, uint8_t *out_row, nearest_columns *columns) {
+    int32_t b = 0;
+    int32_t phase = 0;
+    uint8_t *base = in_row;
+    for (; b + 2 <= columns->simd_blocks; b += 2) {
+        __m256i v = load_m128x2(base + columns->start[phase], base + columns->start[phase + 1]);
+        __m256i mask = _mm256_loadu_si256((__m256i *)(columns->masks + phase * 16));
+        _mm256_storeu_si256((__m256i *)(out_row + b * 16), _mm256_shuffle_epi8(v, mask));
+        if ((phase += 2) == columns->period) {
+            phase = 0;
+            base += columns->advance;
+        }
+    }
+    nearest_pixels(in_row, out_row, columns, b * 16 / columns->channels);
+}
+
+__attribute__((target("avx512bw")))
+void nearest_row_avx512bw(uint8_t *in_row, uint8_t *out_row, nearest_columns *columns) {
+    int32_t b = 0;
+    int32_t phase = 0;
+    uint8_t *base = in_row;
+    for (; b + 4 <= columns->simd_blocks; b += 4) {
+        void *srcs[4] = {
+            base + columns->start[phase], base + columns->start[phase + 1],
+            base + columns->start[phase + 2], base + columns->start[phase + 3]
+        };
+        __m512i v = load_m128x4(srcs, 0);
+        __m512i mask = _mm512_loadu_si512((__m512i *)(columns->masks + phase * 16));
+        _mm512_storeu_si512((__m512i *)(out_row + b * 16), _mm512_shuffle_epi8(v, mask));
+        if ((phase += 4) == columns->period) {
+            phase = 0;
+            base += columns->advance;
+        }
+    }
+    nearest_pixels(in_row, out_row, columns, b * 16 / columns->channels);
+}
+
+// 4 blocks per vpermb: the full 64 byte permute reads them all from one
+// load, where the per-lane pshufb of AVX-512BW needs a load per block
+__attribute__((target("avx512bw,avx512vbmi")))
+void nearest_row_avx512vbmi(uint8_t *in_row, uint8_t *out_row, nearest_columns *columns) {
+    int32_t b = 0;
+    int32_t phase = 0;
+    uint8_t *base = in_row;
+    for (; b + 4 <= columns->wide_blocks; b += 4) {
+        __m512i v = _mm512_loadu_si512((__m512i *)(base + columns->start[phase]));
+        __m512i mask = _mm512_loadu_si512((__m512i *)(columns->masks_wide + phase * 16));
+        _mm512_storeu_si512((__m512i *)(out_row + b * 16), _mm512_permutexvar_epi8(mask, v));
+        if ((phase += 4) == columns->period) {
+            phase = 0;
+            base += columns->advance;
+        }
+    }
+    for (; b < columns->simd_blocks; b++) {
+        __m128i v = _mm_loadu_si128((__m128i *)(base + columns->start[phase]));
+        __m128i mask = _mm_loadu_si128((__m128i *)(columns->masks + phase * 16));
+        _mm_storeu_si128((__m128i *)(out_row + b * 16), _mm_shuffle_epi8(v, mask));
+        if (++phase == columns->period) {
+            phase = 0;
+            base += columns->advance;
+        }
+    }
+    nearest_pixels(in_row, out_row, columns, b * 16 / columns->channels);
+}
+
+/* uint16 / float, SSE4.1 and AVX2 */
+
+// Planar rows: 4 / 8 outputs at a time, each a dot product of stride taps
+// summed across lanes with hadd, like the uint8 kernels. The outputs near
+// the edges get the same dot product and lane sums over a gathered window,
+// so a sample doesn't depend on which path (or tile) computed it. Interleaved rows:
+// one pixel (up to 4 channels) per register, each tap broadcast. The
+// vertical pass is the same multiply-add per tap in the scalar order.
+// AVX-512 hosts run the AVX2 kernels: the passes are load bound in float
+
+__attribute__((target("sse4.1")))
+static inline __m128 load4_ps(uint16_t *src) {
+    return _mm_cvtepi32_ps(_mm_cvtepu16_epi32(_mm_loadl_epi64((__m128i *)src)));
+}
+
+__attribute__((target("sse4.1")))
+static inline __m128 load4_ps(float *src) {
+    return _mm_loadu_ps(src);
+}
+
+__attribute__((target("sse4.1")))
+static inline void store4_ps(uint16_t *dst, __m128 v) {
+    __m128i px = _mm_cvtps_epi32(v);
+    _mm_storel_epi64((__m128i *)dst, _mm_packus_epi32(px, px));
+}
+
+__attribute__((target("sse4.1")))
+static inline void store4_ps(float *dst, __m128 v) {
+    _mm_storeu_ps(dst, v);
+}
+
+__attribute__((target("avx2")))
+static inline __m256 load8_ps(uint16_t *src) {
+    return _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(_mm_loadu_si128((__m128i *)src)));
+}
+
+__attribute__((target("avx2")))
+static inline __m256 load8_ps(float *src) {
+    return _mm256_loadu_ps(src);
+}
+
+__attribute__((target("avx2")))
+static inline void store8_ps(uint16_t *dst, __m256 v) {
+    __m256i px = _mm256_cvtps_epi32(v);
+    px = _mm256_permute4x64_epi64(_mm256_packus_epi32(px, px), 0x08);
+    _mm_storeu_si128((__m128i *)dst, _mm256_castsi256_si128(px));
+}
+
+__attribute__((target("avx2")))
+static inline void store8_ps(float *dst, __m256 v) {
+    _mm256_storeu_ps(dst, v);
+}
+
+// next_outputs() with the float weights
+static inline void next_outputs_float(
+    lanczos_phases *phases, int32_t n,
+    int32_t *base, int32_t *p,
+    int32_t *starts, float **ws
+) {
+    for (int32_t i = 0; i < n; i++) {
+        ws[i] = phases->coeffs_f + *p * phases->stride;
+        starts[i] = *base + phases->offset[*p];
+
+        if (++*p == phases->num_phases) {
+            *p = 0;
+            *base += phases->step;
+        }
+    }
+}
+
+template <typename T>
+__attribute__((target("sse4.1")))
+static inline __m128 dot_taps_sse41(T *src, float *w, int32_t stride) {
+    __m128 acc = _mm_setzero_ps();
+    for (int32_t c = 0; c < stride; c += 4) {
+        acc = _mm_add_ps(acc, _mm_mul_ps(load4_ps(src + c), _mm_loadu_ps(w + c)));
+    }
+    return acc;
+}
+
+// sample start + t of the row, clamped to [lo, hi)
+template <typename T>
+static inline float clamped_tap(T *in_row, int32_t lo, int32_t hi, int32_t start, int32_t t) {
+    return in_row[clamp(start + t, lo, hi - 1)];
+}
+
+// dot_taps_sse41() with every tap clamped
+template <typename T>
+__attribute__((target("sse4.1")))
+static inline __m128 dot_taps_clamped_sse41(T *in_row, int32_t lo, int32_t hi, int32_t start, float *w, int32_t stride) {
+    __m128 acc = _mm_setzero_ps();
+    for (int32_t c = 0; c < stride; c += 4) {
+        __m128 px = _mm_setr_ps(
+            clamped_tap(in_row, lo, hi, start, c), clamped_tap(in_row, lo, hi, start, c + 1),
+            clamped_tap(in_row, lo, hi, start, c + 2), clamped_tap(in_row, lo, hi, start, c + 3)
+        );
+        acc = _mm_add_ps(acc, _mm_mul_ps(px, _mm_loadu_ps(w + c)));
+    }
+    return acc;
+}
+
+// the lane sums of the 4 output kernel for a single output
+__attribute__((target("sse4.1")))
+static inline float hsum_sse41(__m128 acc) {
+    acc = _mm_hadd_ps(acc, acc);
+    return _mm_cvtss_f32(_mm_hadd_ps(acc, acc));
+}
+
+template <typename T>
+__attribute__((target("sse4.1")))
+static void horizontal_border_float_sse41(
+    T *in_row, int32_t lo, int32_t hi,
+    float *inter_row, int32_t x, int32_t x_end,
+    lanczos_phases *phases, int32_t *base, int32_t *p
+) {
+    for (; x < x_end; x++) {
+        int32_t start;
+        float *w;
+        next_outputs_float(phases, 1, base, p, &start, &w);
+        inter_row[x] = hsum_sse41(dot_taps_clamped_sse41(in_row, lo, hi, start, w, phases->stride));
+    }
+}
+
+template <typename T>
+__attribute__((target("sse4.1")))
+static void horizontal_row_float_sse41(
+    T *in_row, int32_t in_w, int32_t pad,
+    float *inter_row, int32_t out_w,
+    lanczos_phases *phases
+) {
+    const int32_t stride = phases->stride;
+    int32_t starts[4];
+    float *ws[4];
+
+    int32_t x0, x1;
+    interior_span(phases, stride, -pad, in_w + pad, out_w, &x0, &x1);
+
+    int32_t base = 0;
+    int32_t p = 0;
+    horizontal_border_float_sse41(in_row, -pad, in_w + pad, inter_row, 0, x0, phases, &base, &p);
+
+    int32_t x = x0;
+    for (; x + 4 <= x1; x += 4) {
+        next_outputs_float(phases, 4, &base, &p, starts, ws);
+
+        __m128 a0 = dot_taps_sse41(in_row + starts[0], ws[0], stride);
+        __m128 a1 = dot_taps_sse41(in_row + starts[1], ws[1], stride);
+        __m128 a2 = dot_taps_sse41(in_row + starts[2], ws[2], stride);
+        __m128 a3 = dot_taps_sse41(in_row + starts[3], ws[3], stride);
+
+        _mm_storeu_ps(inter_row + x, _mm_hadd_ps(_mm_hadd_ps(a0, a1), _mm_hadd_ps(a2, a3)));
+    }
+
+    horizontal_border_float_sse41(in_row, -pad, in_w + pad, inter_row, x, out_w, phases, &base, &p);
+}
+
+template <typename T>
+__attribute__((target("sse4.1")))
+static void vertical_row_float_sse41(
+    float **rows, float *w, int32_t taps,
+    T *out_row, int32_t out_w
+) {
+    int32_t x = 0;
+    for (; x + 4 <= out_w; x += 4) {
+        __m128 acc = _mm_setzero_ps();
+        for (int32_t t = 0; t < taps; t++) {
+            acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(rows[t] + x), _mm_set1_ps(w[t])));
+        }
+        store4_ps(out_row + x, acc);
+    }
+
+    for (; x < out_w; x++) {
+        vertical_pixel_float(rows, w, taps, x, out_row + x);
+    }
+}
+
+// the 4 lane load of the last tap reads up to 4 - channels samples past it,
+// i.e. within one more pixel for channels >= 2
+template <typename T>
+__attribute__((target("sse4.1")))
+static void horizontal_row_interleaved_float_sse41(
+    T *in_row, int32_t in_w, int32_t pad, int32_t channels,
+    float *inter_row, int32_t out_w,
+    lanczos_phases *phases
+) {
+    const int32_t taps = phases->taps;
+
+    int32_t x0, x1;
+    interior_span(phases, taps + 1, -pad, in_w + pad, out_w, &x0, &x1);
+
+    int32_t base = 0;
+    int32_t p = 0;
+    horizontal_border_float(in_row, -pad, in_w + pad, channels, inter_row, 0, x0, phases, &base, &p);
+
+    for (int32_t x = x0; x < x1; x++) {
+        float *w = phases->coeffs_f + p * phases->stride;
+        T *src = in_row + (base + phases->offset[p]) * channels;
+
+        __m128 acc = _mm_setzero_ps();
+        for (int32_t t = 0; t < taps; t++) {
+            acc = _mm_add_ps(acc, _mm_mul_ps(load4_ps(src + t * channels), _mm_set1_ps(w[t])));
+        }
+        float px[4];
+        _mm_storeu_ps(px, acc);
+        memcpy(inter_row + x * channels, px, channels * sizeof(float));
+
+        if (++p == phases->num_phases) {
+            p = 0;
+            base += phases->step;
+        }
+    }
+
+    horizontal_border_float(in_row, -pad, in_w + pad, channels, inter_row, x1, out_w, phases, &base, &p);
+}
+
+template <typename T>
+__attribute__((target("avx2")))
+static inline __m256 dot_taps_avx2(T *src, float *w, int32_t stride) {
+    __m256 acc = _mm256_setzero_ps();
+    for (int32_t c = 0; c < stride; c += 8) {
+        acc = _mm256_add_ps(acc, _mm256_mul_ps(load8_ps(src + c), _mm256_loadu_ps(w + c)));
+    }
+    return acc;
+}
+
+// the lane sums of the 8 output kernel for a single output: each 128-bit
+// half hadd'ed, then the halves added
+__attribute__((target("avx2")))
+static inline float hsum_avx2(__m256 acc) {
+    acc = _mm256_hadd_ps(acc, acc);
+    acc = _mm256_hadd_ps(acc, acc);
+    return _mm_cvtss_f32(_mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1)));
+}
+
+template <typename T>
+__attribute__((target("avx2")))
+static inline __m256 dot_taps_clamped_avx2(T *in_row, int32_t lo, int32_t hi, int32_t start, float *w, int32_t stride) {
+    __m256 acc = _mm256_setzero_ps();
+    for (int32_t c = 0; c < stride; c += 8) {
+        __m256 px = _mm256_setr_ps(
+            clamped_tap(in_row, lo, hi, start, c), clamped_tap(in_row, lo, hi, start, c + 1),
+            clamped_tap(in_row, lo, hi, start, c + 2), clamped_tap(in_row, lo, hi, start, c + 3),
+            clamped_tap(in_row, lo, hi, start, c + 4), clamped_tap(in_row, lo, hi, start, c + 5),
+            clamped_tap(in_row, lo, hi, start, c + 6), clamped_tap(in_row, lo, hi, start, c + 7)
+        );
+        acc = _mm256_add_ps(acc, _mm256_mul_ps(px, _mm256_loadu_ps(w + c)));
+    }
+    return acc;
+}
+
+template <typename T>
+__attribute__((target("avx2")))
+static void horizontal_border_float_avx2(
+    T *in_row, int32_t lo, int32_t hi,
+    float *inter_row, int32_t x, int32_t x_end,
+    lanczos_phases *phases, int32_t *base, int32_t *p
+) {
+    for (; x < x_end; x++) {
+        int32_t start;
+        float *w;
+        next_outputs_float(phases, 1, base, p, &start, &w);
+        inter_row[x] = hsum_avx2(dot_taps_clamped_avx2(in_row, lo, hi, start, w, phases->stride));
+    }
+}
+
+template <typename T>
+__attribute__((target("avx2")))
+static void horizontal_row_float_avx2(
+    T *in_row, int32_t in_w, int32_t pad,
+    float *inter_row, int32_t out_w,
+    lanczos_phases *phases
+) {
+    const int32_t stride = phases->stride;
+    int32_t starts[8];
+    float *ws[8];
+
+    int32_t x0, x1;
+    interior_span(phases, stride, -pad, in_w + pad, out_w, &x0, &x1);
+
+    int32_t base = 0;
+    int32_t p = 0;
+    horizontal_border_float_avx2(in_row, -pad, in_w + pad, inter_row, 0, x0, phases, &base, &p);
+
+    int32_t x = x0;
+    for (; x + 8 <= x1; x += 8) {
+        next_outputs_float(phases, 8, &base, &p, starts, ws);
+
+        __m256 a[8];
+        for (int32_t i = 0; i < 8; i++) {
+            a[i] = dot_taps_avx2(in_row + starts[i], ws[i], stride);
+        }
+
+        // per 128-bit lane: the half sums of outputs 0-3 and 4-7
+        __m256 s0 = _mm256_hadd_ps(_mm256_hadd_ps(a[0], a[1]), _mm256_hadd_ps(a[2], a[3]));
+        __m256 s1 = _mm256_hadd_ps(_mm256_hadd_ps(a[4], a[5]), _mm256_hadd_ps(a[6], a[7]));
+        __m256 s = _mm256_add_ps(_mm256_permute2f128_ps(s0, s1, 0x20), _mm256_permute2f128_ps(s0, s1, 0x31));
+        _mm256_storeu_ps(inter_row + x, s);
+    }
+
+    horizontal_border_float_avx2(in_row, -pad, in_w + pad, inter_row, x, out_w, phases, &base, &p);
+}
+
+template <typename T>
+__attribute__((target("avx2")))
+static void vertical_row_float_avx2(
+    float **rows, float *w, int32_t taps,
+    T *out_row, int32_t out_w
+) {
+    int32_t x = 0;
+    for (; x + 8 <= out_w; x += 8) {
+        __m256 acc = _mm256_setzero_ps();
+        for (int32_t t = 0; t < taps; t++) {
+            acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_loadu_ps(rows[t] + x), _mm256_set1_ps(w[t])));
+        }
+        store8_ps(out_row + x, acc);
+    }
+
+    for (; x < out_w; x++) {
+        vertical_pixel_float(rows, w, taps, x, out_row + x);
+    }
+}
+
+template <typename T>
+const resize_kernels_float<T> *resize_kernels_float_isa(resize_isa isa) {
+    static const resize_kernels_float<T> kernels[ISA_COUNT] = {
+        { horizontal_row_float_scalar<T>, vertical_row_float_scalar<T>, horizontal_row_interleaved_float_scalar<T> },
+        { horizontal_row_float_sse41<T>, vertical_row_float_sse41<T>, horizontal_row_interleaved_float_sse41<T> },
+        { horizontal_row_float_avx2<T>, vertical_row_float_avx2<T>, horizontal_row_interleaved_float_sse41<T> },
+        { horizontal_row_float_avx2<T>, vertical_row_float_avx2<T>, horizontal_row_interleaved_float_sse41<T> }
+    };
+    return &kernels[isa];
+}
+
+template const resize_kernels_float<uint16_t> *resize_kernels_float_isa<uint16_t>(resize_isa isa);
+template const resize_kernels_float<float> *resize_kernels_float_isa<float>(resize_isa isa);
@@ -0,0 +1,155 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "resize_stream.h"
+#include "resize_kernels.h"
+
+static void horizontal_pass(lanczos_stream *stream, uint8_t *row, int16_t *slot) {
+    if (stream->channels == 1) {
+        stream->kernels->horizontal_row(row, stream->in_w, stream->pad, slot, stream->out_w, stream->phases);
+    } else {
+        stream->kernels->horizontal_row_interleaved(row, stream->in_w, stream->pad, stream->channels, slot, stream->out_w, stream->phases);
+    }
+}
+
+lanczos_stream *lanczos_stream_create(
+    int32_t in_w,
+    int32_t in_h,
+    int32_t channels,
+    int32_t num,
+    int32_t den,
+    int32_t a,
+    resize_border border,
+    uint8_t border_value
+) {
+    if (in_w <= 0 || in_h <= 0 || num <= 0 || den <= 0 || channels < 1 || channels > 4) {
+        printf("invalid stream: %ix%ix%i, scale %i/%i\n", in_w, in_h, channels, num, den);
+        return NULL;
+    }
+    if (border == BORDER_WRAP) {
+        // the first output rows would need the last input rows
+        printf("a stream can't wrap around the top border\n");
+        return NULL;
+    }
+
+    int32_t g = gcd(num, den);
+    int32_t p = num / g;
+    int32_t q = den / g;
+
+    // held until lanczos_stream_free(): the bank cache never frees a bank,
+    // whatever other geometries are resized meanwhile
+    lanczos_phases *phases;
+    const resize_kernels *kernels;
+    if (!lanczos_bank(p, q, a, &phases, &kernels)) return NULL;
+
+    lanczos_stream *stream = (lanczos_stream *)malloc(sizeof(lanczos_stream));
+    stream->in_w = in_w;
+    stream->in_h = in_h;
+    stream->out_w = (int64_t)in_w * p / q;
+    stream->out_h = (int64_t)in_h * p / q;
+    stream->channels = channels;
+    stream->phases = phases;
+    stream->kernels = kernels;
+    stream->rows_in = 0;
+    stream->rows_out = 0;
+    stream->base = 0;
+    stream->p = 0;
+    stream->border = border;
+    stream->border_value = border_value;
+    stream->pad = border == BORDER_CLAMP ? 0 : border_pad(phases, in_w, stream->out_w);
+    stream->padded = (uint8_t *)malloc((int64_t)(in_w + 2 * stream->pad) * channels);
+    stream->ring = (int16_t *)malloc((int64_t)(phases->taps + 1) * stream->out_w * channels * sizeof(int16_t));
+    stream->rows = (int16_t **)malloc(phases->taps * sizeof(int16_t *));
+
+    // slot taps of the ring: the rows past the edges for BORDER_CONSTANT
+    if (border == BORDER_CONSTANT) {
+        memset(stream->padded, border_value, (int64_t)(in_w + 2 * stream->pad) * channels);
+        horizontal_pass(stream, stream->padded + stream->pad * channels, stream->ring + (int64_t)phases->taps * stream->out_w * channels);
+    }
+    return stream;
+}
+
+void lanczos_stream_free(lanczos_stream *stream) {
+    if (!stream) return;
+    free(stream->rows);
+    free(stream->ring);
+    free(stream->padded);
+    free(stream);
+}
+
+void lanczos_stream_reset(lanczos_stream *stream) {
+    stream->rows_in = 0;
+    stream->rows_out = 0;
+    stream->base = 0;
+    stream->p = 0;
+}
+
+// input rows under the next output row, mapped into the image by the
+// border mode; rows of BORDER_CONSTANT aren't input rows
+static void next_window(lanczos_stream *stream, int32_t *first, int32_t *last) {
+    int32_t start = stream->base + stream->phases->offset[stream->p];
+    *first = INT32_MAX;
+    *last = -1;
+    for (int32_t t = 0; t < stream->phases->taps; t++) {
+        int32_t in_y = border_index(start + t, stream->in_h, stream->border);
+        if (in_y < 0) continue;
+        if (in_y < *first) *first = in_y;
+        if (in_y > *last) *last = in_y;
+    }
+}
+
+static bool next_ready(lanczos_stream *stream) {
+    if (stream->rows_out == stream->out_h) return false;
+
+    int32_t first, last;
+    next_window(stream, &first, &last);
+    return stream->rows_in > last;
+}
+
+bool lanczos_stream_push(lanczos_stream *stream, uint8_t *row) {
+    int32_t taps = stream->phases->taps;
+    if (stream->rows_in == stream->in_h) return false;
+
+    // the slot of this row still holds row rows_in - taps, needed only if
+    // the pending output row is complete
+    if (next_ready(stream)) {
+        int32_t first, last;
+        next_window(stream, &first, &last);
+        if (stream->rows_in - taps >= first) return false;
+    }
+
+    int32_t width = stream->out_w * stream->channels;
+    int16_t *slot = stream->ring + (int64_t)(stream->rows_in % taps) * width;
+    if (stream->border != BORDER_CLAMP) {
+        border_pad_row(row, stream->in_w, stream->channels, stream->pad, stream->border, stream->border_value, stream->padded);
+        row = stream->padded + stream->pad * stream->channels;
+    }
+    horizontal_pass(stream, row, slot);
+
+    stream->rows_in++;
+    return true;
+}
+
+bool lanczos_stream_pull(lanczos_stream *stream, uint8_t *out_row) {
+    lanczos_phases *phases = stream->phases;
+    int32_t taps = phases->taps;
+    if (!next_ready(stream)) return false;
+
+    // same border rows as lanczos_strip(), the ring just holds each once
+    int32_t width = stream->out_w * stream->channels;
+    int32_t start = stream->base + phases->offset[stream->p];
+    for (int32_t t = 0; t < taps; t++) {
+        int32_t in_y = border_index(start + t, stream->in_h, stream->border);
+        int32_t slot = in_y < 0 ? taps : in_y % taps;
+        stream->rows[t] = stream->ring + (int64_t)slot * width;
+    }
+    stream->kernels->vertical_row(stream->rows, phases->coeffs + stream->p * phases->stride, taps, out_row, width);
+
+    stream->rows_out++;
+    if (++stream->p == phases->num_phases) {
+        stream->p = 0;
+        stream->base += phases->step;
+    }
+    return true;
+}
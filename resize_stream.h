@@ -0,0 +1,64 @@
+#pragma once
+
+// Row streaming resize: input rows are pushed as they are decoded and output
+// rows pulled as soon as their input window is complete, the way aie2.py
+// streams rows through its ObjectFifos. The only buffer is a ring of taps
+// horizontally filtered rows, so memory doesn't depend on the image height
+
+#include <stdint.h>
+
+#include "resize.h"
+
+struct resize_kernels;
+
+struct lanczos_stream {
+    int32_t in_w;
+    int32_t in_h;
+    int32_t out_w;
+    int32_t out_h;
+    int32_t channels;
+    lanczos_phases *phases;     // from lanczos_bank(): compile-time or cached,
+                                // pinned for the life of the process
+    const resize_kernels *kernels;
+    int32_t rows_in;    // input rows pushed so far
+    int32_t rows_out;   // output rows pulled so far
+    int32_t base;       // bank position of the next output row
+    int32_t p;
+    resize_border border;
+    uint8_t border_value;
+    int32_t pad;        // border_pad() columns, 0 for BORDER_CLAMP
+    uint8_t *padded;    // padded row view of the row being pushed
+    int16_t *ring;      // taps x out_w * channels, input row r in slot r % taps,
+                        // then the BORDER_CONSTANT row
+    int16_t **rows;     // taps
+};
+
+// out = in * num / den, 1 to 4 interleaved channels, same borders as
+// lanczos_interleaved() except BORDER_WRAP, which needs the whole frame.
+// NULL if the parameters are invalid
+lanczos_stream *lanczos_stream_create(
+    int32_t in_w,
+    int32_t in_h,
+    int32_t channels,
+    int32_t num,
+    int32_t den,
+    int32_t a,
+    resize_border border = BORDER_CLAMP,
+    uint8_t border_value = 0
+);
+
+void lanczos_stream_free(lanczos_stream *stream);
+
+// Rewinds to the first row for the next frame of the same size, keeping the
+// ring: a stream reused this way doesn't allocate after creation
+void lanczos_stream_reset(lanczos_stream *stream);
+
+// Feeds the next input row (in_w * channels bytes). Returns false if it
+// can't be taken: all in_h rows were pushed already, or the ring is full
+// because the next output row is complete and has to be pulled first
+bool lanczos_stream_push(lanczos_stream *stream, uint8_t *row);
+
+// Writes the next output row (out_w * channels bytes) if all of its input
+// rows were pushed. Returns false otherwise, or when all out_h rows were
+// pulled
+bool lanczos_stream_pull(lanczos_stream *stream, uint8_t *out_row);
@@ -0,0 +1,159 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+
+#include "resize.h"
+
+// sysfs cache size, e.g. "48K" or "32M", 0 if unreadable
+static int64_t read_cache_size(const char *path) {
+    FILE *f = fopen(path, "r");
+    if (!f) return 0;
+
+    long long size = 0;
+    char unit = 0;
+    int32_t n = fscanf(f, "%lld%c", &size, &unit);
+    fclose(f);
+
+    if (n < 1) return 0;
+    if (unit == 'K') size *= 1024;
+    if (unit == 'M') size *= 1024 * 1024;
+    return size;
+}
+
+resize_caches resize_get_caches() {
+    resize_caches caches = { 0, 0, 0 };
+
+    for (int32_t index = 0; ; index++) {
+        char path[128];
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%i/level", index);
+        FILE *f = fopen(path, "r");
+        if (!f) break;
+
+        int32_t level = 0;
+        char type[32] = "";
+        int32_t n = fscanf(f, "%i", &level);
+        fclose(f);
+
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%i/type", index);
+        f = fopen(path, "r");
+        if (f) {
+            n += fscanf(f, "%31s", type);
+            fclose(f);
+        }
+        if (n < 2 || !strcmp(type, "Instruction")) continue;
+
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%i/size", index);
+        int64_t size = read_cache_size(path);
+        if (level == 1) caches.l1 = size;
+        if (level == 2) caches.l2 = size;
+        if (level == 3) caches.l3 = size;
+    }
+
+    return caches;
+}
+
+// one line: the caches it was tuned for, then the tile shape
+static bool profile_load(const char *profile, resize_caches caches, resize_tile *tile) {
+    FILE *f = fopen(profile, "r");
+    if (!f) return false;
+
+    long long l1, l2, l3, bytes;
+    int32_t rows;
+    int32_t n = fscanf(f, "%lld %lld %lld %lld %i", &l1, &l2, &l3, &bytes, &rows);
+    fclose(f);
+
+    if (n != 5 || l1 != caches.l1 || l2 != caches.l2 || l3 != caches.l3) return false;
+    tile->bytes = bytes;
+    tile->rows = rows;
+    return true;
+}
+
+static void profile_store(const char *profile, resize_caches caches, resize_tile tile) {
+    FILE *f = fopen(profile, "w");
+    if (!f) {
+        printf("can't write the tile profile %s\n", profile);
+        return;
+    }
+
+    fprintf(f, "%lld %lld %lld %lld %i\n",
+        (long long)caches.l1, (long long)caches.l2, (long long)caches.l3, (long long)tile.bytes, tile.rows);
+    fclose(f);
+}
+
+#define TUNE_A 3
+#define TUNE_CHANNELS 3
+#define TUNE_RUNS 1
+
+// best of TUNE_RUNS after a warm up run, in ms
+static double time_tile(resize_tile tile, uint8_t *in, int32_t in_w, int32_t in_h, uint8_t *out) {
+    resize_set_tile(tile);
+
+    double best = 0;
+    for (int32_t run = 0; run <= TUNE_RUNS; run++) {
+        auto start = std::chrono::high_resolution_clock::now();
+        lanczos_into(in, in_w, in_h, in_w * TUNE_CHANNELS, out, 2 * in_w * TUNE_CHANNELS, TUNE_CHANNELS, 2, 1, TUNE_A);
+        auto stop = std::chrono::high_resolution_clock::now();
+
+        double ms = std::chrono::duration<double, std::milli>(stop - start).count();
+        if (run == 1 || (run > 1 && ms < best)) best = ms;
+    }
+    return best;
+}
+
+resize_tile resize_autotune(const char *profile) {
+    resize_caches caches = resize_get_caches();
+    resize_tile tile;
+    if (profile_load(profile, caches, &tile)) {
+        resize_set_tile(tile);
+        return tile;
+    }
+
+    // RGB 2x with a = 3 has 2a * 3 int16 intermediate samples per output
+    // column: make its untiled ring twice the L2, and tall enough for two
+    // strips of the tallest candidate
+    int64_t l2 = caches.l2 ? caches.l2 : DEFAULT_L2;
+    int64_t column_bytes = 2 * TUNE_A * TUNE_CHANNELS * sizeof(int16_t);
+    int32_t in_w = 2 * l2 / column_bytes / 2;
+    int32_t in_h = DEFAULT_TILE_ROWS;
+
+    uint8_t *in = (uint8_t *)malloc((int64_t)in_w * in_h * TUNE_CHANNELS);
+    uint8_t *out = (uint8_t *)malloc((int64_t)4 * in_w * in_h * TUNE_CHANNELS);
+    for (int64_t i = 0; i < (int64_t)in_w * in_h * TUNE_CHANNELS; i++) {
+        in[i] = i * 7 + i / in_w;
+    }
+
+    resize_tile untiled = { 0, 0 };
+    double untiled_ms = time_tile(untiled, in, in_w, in_h, out);
+    tile = untiled;
+    double best_ms = untiled_ms;
+
+    for (int64_t bytes = l2 / 8; bytes <= l2; bytes *= 2) {
+        for (int32_t rows = DEFAULT_TILE_ROWS / 4; rows <= DEFAULT_TILE_ROWS; rows *= 2) {
+            resize_tile candidate = { bytes, rows };
+            double ms = time_tile(candidate, in, in_w, in_h, out);
+            if (ms < best_ms) {
+                best_ms = ms;
+                tile = candidate;
+            }
+        }
+    }
+
+    // again, in case the clock was still ramping up the first time
+    double again_ms = time_tile(untiled, in, in_w, in_h, out);
+    if (again_ms < untiled_ms) untiled_ms = again_ms;
+    if (untiled_ms <= best_ms) {
+        best_ms = untiled_ms;
+        tile = untiled;
+    }
+
+    free(in);
+    free(out);
+
+    printf("autotuned tile: %lld bytes x %i rows, %.1lf ms (untiled %.1lf ms)\n",
+        (long long)tile.bytes, tile.rows, best_ms, untiled_ms);
+    resize_set_tile(tile);
+    profile_store(profile, caches, tile);
+    return tile;
+}
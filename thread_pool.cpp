@@ -0,0 +1,171 @@
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "thread_pool.h"
+
+// a range of task ids [begin, end) packed in one word so it can be CAS'd
+static inline uint64_t pack_range(uint32_t begin, uint32_t end) {
+    return ((uint64_t)begin << 32) | end;
+}
+
+struct alignas(64) task_queue {
+    std::atomic<uint64_t> range;
+};
+
+struct thread_pool {
+    std::vector<std::thread> workers;
+    task_queue *queues;
+
+    std::mutex run_mutex;   // one job at a time
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    uint64_t generation = 0;
+    int32_t pending = 0;
+    bool stop = false;
+
+    // current job
+    thread_pool_fn fn;
+    void *ctx;
+    int32_t participants;
+
+    thread_pool();
+    ~thread_pool();
+};
+
+static thread_local bool in_pool = false;
+
+static int32_t pop_task(task_queue *q) {
+    uint64_t v = q->range.load();
+    for (;;) {
+        uint32_t begin = v >> 32;
+        uint32_t end = (uint32_t)v;
+        if (begin >= end) return -1;
+        if (q->range.compare_exchange_weak(v, pack_range(begin + 1, end))) return begin;
+    }
+}
+
+// moves the back half of victim's range into the (empty) queue of the thief
+static bool steal_tasks(task_queue *victim, task_queue *thief) {
+    uint64_t v = victim->range.load();
+    for (;;) {
+        uint32_t begin = v >> 32;
+        uint32_t end = (uint32_t)v;
+        if (begin >= end) return false;
+
+        uint32_t n = (end - begin + 1) / 2;
+        if (victim->range.compare_exchange_weak(v, pack_range(begin, end - n))) {
+            thief->range.store(pack_range(end - n, end));
+            return true;
+        }
+    }
+}
+
+static void run_tasks(thread_pool *pool, int32_t worker) {
+    task_queue *own = &pool->queues[worker];
+
+    for (;;) {
+        int32_t task = pop_task(own);
+        if (task >= 0) {
+            pool->fn(task, worker, pool->ctx);
+            continue;
+        }
+
+        bool stolen = false;
+        for (int32_t i = 1; i < pool->participants && !stolen; i++) {
+            stolen = steal_tasks(&pool->queues[(worker + i) % pool->participants], own);
+        }
+        if (!stolen) return;
+    }
+}
+
+static void worker_loop(thread_pool *pool, int32_t worker) {
+    in_pool = true;
+    uint64_t seen = 0;
+
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(pool->mutex);
+            pool->wake.wait(lock, [&] { return pool->stop || pool->generation != seen; });
+            if (pool->stop) return;
+            seen = pool->generation;
+            if (worker >= pool->participants) continue;
+        }
+
+        run_tasks(pool, worker);
+
+        std::lock_guard<std::mutex> lock(pool->mutex);
+        if (--pool->pending == 0) pool->done.notify_one();
+    }
+}
+
+thread_pool::thread_pool() {
+    int32_t n = std::thread::hardware_concurrency();
+    if (n < 1) n = 1;
+
+    queues = new task_queue[n];
+    // worker 0 is always the calling thread
+    for (int32_t i = 1; i < n; i++) {
+        workers.emplace_back(worker_loop, this, i);
+    }
+}
+
+thread_pool::~thread_pool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    wake.notify_all();
+    for (std::thread &t : workers) t.join();
+    delete[] queues;
+}
+
+static thread_pool *get_pool() {
+    static thread_pool pool;
+    return &pool;
+}
+
+int32_t thread_pool_participants(int32_t threads) {
+    int32_t n = get_pool()->workers.size() + 1;
+    if (threads <= 0 || threads > n) return n;
+    return threads;
+}
+
+void thread_pool_run(int32_t num_tasks, int32_t threads, thread_pool_fn fn, void *ctx) {
+    int32_t participants = thread_pool_participants(threads);
+    if (participants > num_tasks) participants = num_tasks;
+
+    if (in_pool || participants <= 1) {
+        for (int32_t task = 0; task < num_tasks; task++) fn(task, 0, ctx);
+        return;
+    }
+
+    thread_pool *pool = get_pool();
+    std::lock_guard<std::mutex> run_lock(pool->run_mutex);
+
+    for (int32_t i = 0; i < participants; i++) {
+        int32_t begin = (int64_t)num_tasks * i / participants;
+        int32_t end = (int64_t)num_tasks * (i + 1) / participants;
+        pool->queues[i].range.store(pack_range(begin, end));
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(pool->mutex);
+        pool->fn = fn;
+        pool->ctx = ctx;
+        pool->participants = participants;
+        pool->pending = participants - 1;
+        pool->generation++;
+    }
+    pool->wake.notify_all();
+
+    in_pool = true;
+    run_tasks(pool, 0);
+    in_pool = false;
+
+    std::unique_lock<std::mutex> lock(pool->mutex);
+    pool->done.wait(lock, [&] { return pool->pending == 0; });
+}
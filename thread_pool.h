@@ -0,0 +1,17 @@
+#pragma once
+
+#include <stdint.h>
+
+// Process-wide pool of worker threads, created on first use and reused by
+// every resize call. Tasks are split into one contiguous range per
+// participant; a participant that runs out steals half of another's range.
+
+typedef void (*thread_pool_fn)(int32_t task, int32_t worker, void *ctx);
+
+// number of threads that will run tasks for a threads request (0 = all cores),
+// the caller included. Worker ids passed to fn are in [0, this)
+int32_t thread_pool_participants(int32_t threads);
+
+// runs fn(task, worker, ctx) for every task in [0, num_tasks) and returns
+// when all of them are done. Nested calls from a task run serially
+void thread_pool_run(int32_t num_tasks, int32_t threads, thread_pool_fn fn, void *ctx);
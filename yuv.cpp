@@ -0,0 +1,117 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "yuv.h"
+#include "resize.h"
+#include "resize_kernels.h"
+
+static int32_t y_stride(const yuv_frame *frame) {
+    return frame->y_stride ? frame->y_stride : frame->w;
+}
+
+static int32_t uv_stride(const yuv_frame *frame) {
+    int32_t packed = yuv_chroma_size(frame->w) * (frame->layout == YUV_NV12 ? 2 : 1);
+    return frame->uv_stride ? frame->uv_stride : packed;
+}
+
+bool lanczos_yuv420(
+    const yuv_frame *in,
+    yuv_frame *out,
+    int32_t num,
+    int32_t den,
+    int32_t a_luma,
+    int32_t a_chroma,
+    int32_t threads
+) {
+    if (num <= 0 || den <= 0) {
+        printf("invalid scale factor %i/%i\n", num, den);
+        return false;
+    }
+
+    out->layout = in->layout;
+    out->w = (int64_t)in->w * num / den;
+    out->h = (int64_t)in->h * num / den;
+    out->y_stride = 0;
+    out->uv_stride = 0;
+
+    int64_t luma_size = (int64_t)out->w * out->h;
+    int64_t chroma_size = (int64_t)yuv_chroma_size(out->w) * yuv_chroma_size(out->h);
+    out->y = (uint8_t *)malloc(luma_size * sizeof(uint8_t));
+    if (in->layout == YUV_NV12) {
+        out->u = (uint8_t *)malloc(2 * chroma_size * sizeof(uint8_t));
+        out->v = NULL;
+    } else {
+        out->u = (uint8_t *)malloc(chroma_size * sizeof(uint8_t));
+        out->v = (uint8_t *)malloc(chroma_size * sizeof(uint8_t));
+    }
+
+    if (!lanczos_yuv420_into(in, out, num, den, a_luma, a_chroma, threads)) {
+        yuv_frame_free(out);
+        return false;
+    }
+    return true;
+}
+
+bool lanczos_yuv420_into(
+    const yuv_frame *in,
+    yuv_frame *out,
+    int32_t num,
+    int32_t den,
+    int32_t a_luma,
+    int32_t a_chroma,
+    int32_t threads
+) {
+    if (num <= 0 || den <= 0) {
+        printf("invalid scale factor %i/%i\n", num, den);
+        return false;
+    }
+    if (in->w < 1 || in->h < 1) {
+        printf("invalid frame size %ix%i\n", in->w, in->h);
+        return false;
+    }
+    if ((a_luma && !resize_filter_get(a_luma, NULL)) || (a_chroma && !resize_filter_get(a_chroma, NULL))) {
+        printf("a=%i/%i should be 0 (nearest), greater than 0 or a FILTER_*\n", a_luma, a_chroma);
+        return false;
+    }
+
+    int32_t g = gcd(num, den);
+    int32_t p = num / g;
+    int32_t q = den / g;
+
+    out->layout = in->layout;
+    out->w = (int64_t)in->w * p / q;
+    out->h = (int64_t)in->h * p / q;
+
+    int32_t in_cw = yuv_chroma_size(in->w);
+    int32_t in_ch = yuv_chroma_size(in->h);
+    int32_t out_cw = yuv_chroma_size(out->w);
+    int32_t out_ch = yuv_chroma_size(out->h);
+    int32_t uv_channels = in->layout == YUV_NV12 ? 2 : 1;
+
+    if (!out->y || !out->u || (out->layout == YUV_I420 && !out->v)) {
+        printf("missing output plane\n");
+        return false;
+    }
+    if (y_stride(out) < out->w || uv_stride(out) < out_cw * uv_channels) {
+        printf("row stride %i/%i shorter than a row\n", out->y_stride, out->uv_stride);
+        return false;
+    }
+
+    // Same p/q bank for every plane: chroma sample i sits on luma sample 2i
+    // on both sides, so the chroma grid maps exactly like the luma one
+    bool ok = resize_plane(in->y, in->w, in->h, y_stride(in), 1, out->y, out->w, out->h, y_stride(out), p, q, a_luma, BORDER_CLAMP, 0, threads);
+    ok = ok && resize_plane(in->u, in_cw, in_ch, uv_stride(in), uv_channels, out->u, out_cw, out_ch, uv_stride(out), p, q, a_chroma, BORDER_CLAMP, 0, threads);
+    if (in->layout == YUV_I420) {
+        ok = ok && resize_plane(in->v, in_cw, in_ch, uv_stride(in), 1, out->v, out_cw, out_ch, uv_stride(out), p, q, a_chroma, BORDER_CLAMP, 0, threads);
+    }
+    return ok;
+}
+
+void yuv_frame_free(yuv_frame *frame) {
+    free(frame->y);
+    free(frame->u);
+    free(frame->v);
+    frame->y = NULL;
+    frame->u = NULL;
+    frame->v = NULL;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+// 4:2:0 video frames: full size luma, chroma subsampled by 2 on both axes
+// (rounded up). I420 keeps U and V in two planes, NV12 in one plane of
+// interleaved UV pairs
+
+#include <stdint.h>
+
+enum yuv_layout {
+    YUV_I420,
+    YUV_NV12
+};
+
+struct yuv_frame {
+    yuv_layout layout;
+    int32_t w;
+    int32_t h;
+    uint8_t *y;     // w x h
+    uint8_t *u;     // chroma_w x chroma_h, NV12: interleaved UV
+    uint8_t *v;     // chroma_w x chroma_h, unused by NV12
+    int32_t y_stride;   // bytes between rows, 0 = packed
+    int32_t uv_stride;  // of u and v
+};
+
+static inline int32_t yuv_chroma_size(int32_t luma_size) {
+    return (luma_size + 1) / 2;
+}
+
+// Resizes every plane of in by num/den into out (same layout, planes
+// malloc'ed, release them with yuv_frame_free()). The chroma planes are
+// sized from the output luma, not scaled on their own, so they stay
+// aligned with it. a_luma / a_chroma pick the filter of each plane: the
+// Lanczos a, FILTER_BILINEAR / FILTER_BICUBIC, or 0 for nearest neighbor,
+// e.g. 3 on luma where the detail is and 1 on chroma. Returns false if the
+// parameters are invalid
+bool lanczos_yuv420(
+    const yuv_frame *in,
+    yuv_frame *out,
+    int32_t num,
+    int32_t den,
+    int32_t a_luma,
+    int32_t a_chroma,
+    int32_t threads = 0
+);
+
+// lanczos_yuv420() into the planes the caller set in out, sized
+// in * num / den (out->w, out->h and the layout are filled in). Doesn't
+// allocate in steady state, see lanczos_into()
+bool lanczos_yuv420_into(
+    const yuv_frame *in,
+    yuv_frame *out,
+    int32_t num,
+    int32_t den,
+    int32_t a_luma,
+    int32_t a_chroma,
+    int32_t threads = 0
+);
+
+void yuv_frame_free(yuv_frame *frame);